@@ -0,0 +1,59 @@
+#include "bench.hpp"
+
+#include "lib/voices/voice_manager.hpp"
+
+#include "app/engines/synths/ottofm/fm_bank.hpp"
+#include "app/engines/synths/ottofm/voice.hpp"
+
+using namespace otto;
+using namespace otto::engines::ottofm;
+
+namespace {
+  /// Six voices of OTTO.FM, with three notes held
+  struct Voices {
+    Voices(int algorithm)
+    {
+      state.algorithm_idx = algorithm;
+      for (auto& v : vmgr) v.on_state_change(state);
+      for (int note : {60, 64, 67}) vmgr.handle(midi::NoteOn{static_cast<std::uint8_t>(note)});
+    }
+    itc::Channel chan;
+    State state;
+    voices::VoiceManager<Voice, 6> vmgr = {chan, state};
+  };
+} // namespace
+
+OTTO_BENCHMARK("ottofm: FMOperator per algorithm")
+{
+  itc::ImmediateExecutor ex;
+  AudioDomain::set_static_executor(ex);
+
+  std::array<float, 256> buffer = {};
+  bench.unit("frame").batch(buffer.size());
+  for (int alg = 0; alg < Voice::algorithm_count; alg++) {
+    Voices voices(alg);
+    bench.run(fmt::format("algorithm {}", alg), [&] {
+      voices.vmgr.process(buffer);
+      bench::doNotOptimizeAway(buffer);
+    });
+  }
+  AudioDomain::set_static_executor(nullptr);
+}
+
+OTTO_BENCHMARK("ottofm: FMVoiceBank per algorithm")
+{
+  itc::ImmediateExecutor ex;
+  AudioDomain::set_static_executor(ex);
+
+  std::array<float, 256> buffer = {};
+  bench.unit("frame").batch(buffer.size());
+  for (int alg = 0; alg < Voice::algorithm_count; alg++) {
+    Voices voices(alg);
+    FMVoiceBank<6> bank;
+    bench.run(fmt::format("algorithm {}", alg), [&] {
+      bank.process(voices.vmgr.voices(), buffer);
+      bench::doNotOptimizeAway(buffer);
+    });
+  }
+  AudioDomain::set_static_executor(nullptr);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+#include <nanobench.h>
+
+namespace otto::bench {
+
+  using Bench = ankerl::nanobench::Bench;
+  using ankerl::nanobench::doNotOptimizeAway;
+
+  /// A group of benchmarks, sharing a title in the output
+  struct Benchmark {
+    std::string_view name;
+    void (*run)(Bench&);
+  };
+
+  /// All benchmarks registered with `OTTO_BENCHMARK`
+  inline std::vector<Benchmark>& registry()
+  {
+    static std::vector<Benchmark> instance;
+    return instance;
+  }
+
+  inline bool register_benchmark(std::string_view name, void (*run)(Bench&))
+  {
+    registry().push_back({name, run});
+    return true;
+  }
+
+} // namespace otto::bench
+
+#define OTTO_BENCH_CAT_IMPL(A, B) A##B
+#define OTTO_BENCH_CAT(A, B) OTTO_BENCH_CAT_IMPL(A, B)
+
+/// Define and register a benchmark group.
+///
+/// The body gets a `Bench& bench` with the title set to `Name`. Call `bench.run` for each case.
+/// ```cpp
+/// OTTO_BENCHMARK("voices") {
+///   bench.run("poly", [&] { ... });
+/// }
+/// ```
+#define OTTO_BENCHMARK(Name)                                                                                           \
+  static void OTTO_BENCH_CAT(otto_bench_, __LINE__)(::otto::bench::Bench & bench);                                     \
+  [[maybe_unused]] static const bool OTTO_BENCH_CAT(otto_bench_registered_, __LINE__) =                                \
+    ::otto::bench::register_benchmark(Name, OTTO_BENCH_CAT(otto_bench_, __LINE__));                                    \
+  static void OTTO_BENCH_CAT(otto_bench_, __LINE__)(::otto::bench::Bench & bench)
@@ -0,0 +1,28 @@
+#include "bench.hpp"
+
+#include "lib/util/audio_buffer.hpp"
+
+using namespace otto;
+
+OTTO_BENCHMARK("AudioBufferPool")
+{
+  util::AudioBufferPool pool(16, 256);
+
+  bench.run("allocate and release", [&] {
+    auto buf = pool.allocate();
+    bench::doNotOptimizeAway(buf.data());
+  });
+
+  // Allocations with most of the pool in use
+  std::vector<util::audio_buffer> held;
+  for (int i = 0; i < 12; i++) held.push_back(pool.allocate());
+  bench.run("allocate and release, 12/16 in use", [&] {
+    auto buf = pool.allocate();
+    bench::doNotOptimizeAway(buf.data());
+  });
+
+  bench.run("allocate_stereo and release", [&] {
+    auto buf = pool.allocate_stereo();
+    bench::doNotOptimizeAway(buf.left.data());
+  });
+}
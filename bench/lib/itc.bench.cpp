@@ -0,0 +1,52 @@
+#include "bench.hpp"
+
+#include "lib/itc/itc.hpp"
+
+using namespace otto;
+
+namespace {
+  struct BenchState {
+    int i = 0;
+    float f = 0;
+    std::array<float, 16> values = {};
+    DECL_VISIT(i, f, values);
+  };
+
+  using BenchDomain = itc::StaticDomain<struct bench_domain_tag>;
+  using BenchConsumer = itc::WithDomain<BenchDomain, itc::Consumer<BenchState>>;
+} // namespace
+
+OTTO_BENCHMARK("QueueExecutor")
+{
+  itc::QueueExecutor ex;
+  int counter = 0;
+
+  // The queue is bounded, so each iteration drains what it queued. The last case fills it.
+  for (int n : {1, 16, 256, static_cast<int>(ex.capacity())}) {
+    bench.batch(n).run(fmt::format("execute and drain {}", n), [&] {
+      for (int i = 0; i < n; i++) ex.execute([&] { counter++; });
+      ex.run_queued_functions();
+    });
+  }
+  bench::doNotOptimizeAway(counter);
+}
+
+OTTO_BENCHMARK("Producer::commit")
+{
+  itc::QueueExecutor ex;
+  BenchDomain::set_static_executor(ex);
+
+  for (int n : {1, 4, 16}) {
+    itc::Channel chan;
+    itc::Producer<BenchState> prod = chan;
+    std::vector<std::unique_ptr<BenchConsumer>> consumers;
+    for (int i = 0; i < n; i++) consumers.push_back(std::make_unique<BenchConsumer>(chan));
+
+    bench.run(fmt::format("commit to {} consumers", n), [&] {
+      prod.state().i++;
+      prod.commit();
+      ex.run_queued_functions();
+    });
+  }
+  BenchDomain::set_static_executor(nullptr);
+}
@@ -0,0 +1,35 @@
+#include "bench.hpp"
+
+#include "lib/itc/itc.hpp"
+#include "lib/util/serialization.hpp"
+#include "lib/voices/voice_manager.hpp"
+
+#include "app/engines/midi-fx/arp/arp.hpp"
+#include "app/engines/synths/ottofm/ottofm.hpp"
+#include "app/services/logic_thread.hpp"
+
+using namespace otto;
+
+OTTO_BENCHMARK("util::serialize")
+{
+  itc::ImmediateExecutor ex;
+  AudioDomain::set_static_executor(ex);
+  LogicDomain::set_static_executor(ex);
+
+  // The same context as the application, without audio and screens
+  itc::Context ctx;
+  auto synth_logic = engines::ottofm::make_logic(ctx["synth"]);
+  auto voices_logic = voices::make_voices_logic(ctx["synth"]);
+  auto arp_logic = engines::arp::make_logic(ctx["midifx"]);
+
+  bench.run("serialize itc::Context", [&] {
+    auto json = util::serialize(ctx);
+    bench::doNotOptimizeAway(json);
+  });
+
+  const auto json = util::serialize(ctx);
+  bench.run("deserialize itc::Context", [&] { util::deserialize_from(json, ctx); });
+
+  LogicDomain::set_static_executor(nullptr);
+  AudioDomain::set_static_executor(nullptr);
+}
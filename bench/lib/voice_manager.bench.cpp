@@ -0,0 +1,38 @@
+#include "bench.hpp"
+
+#include <magic_enum.hpp>
+
+#include "lib/voices/voice_manager.hpp"
+
+#include "app/engines/synths/ottofm/voice.hpp"
+
+using namespace otto;
+using namespace otto::voices;
+
+OTTO_BENCHMARK("VoiceManager::process")
+{
+  itc::ImmediateExecutor ex;
+  AudioDomain::set_static_executor(ex);
+
+  {
+    itc::Channel chan;
+    itc::Producer<VoicesState> prod = chan;
+    engines::ottofm::State state;
+    VoiceManager<engines::ottofm::Voice, 6> vmgr(chan, state);
+    for (auto& v : vmgr) v.on_state_change(state);
+
+    std::array<float, 256> buffer = {};
+    bench.unit("frame").batch(buffer.size());
+    for (auto mode : magic_enum::enum_values<PlayMode>()) {
+      prod.state().play_mode = mode;
+      prod.commit();
+      for (int note : {60, 64, 67}) vmgr.handle(midi::NoteOn{static_cast<std::uint8_t>(note)});
+      bench.run(std::string(magic_enum::enum_name(mode)), [&] {
+        vmgr.process(buffer);
+        bench::doNotOptimizeAway(buffer);
+      });
+      for (int note : {60, 64, 67}) vmgr.handle(midi::NoteOff{static_cast<std::uint8_t>(note)});
+    }
+  }
+  AudioDomain::set_static_executor(nullptr);
+}
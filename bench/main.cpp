@@ -0,0 +1,57 @@
+#define ANKERL_NANOBENCH_IMPLEMENT
+#include "bench.hpp"
+
+#include <fstream>
+#include <iostream>
+
+#include <Gamma/Domain.h>
+#include <lyra.hpp>
+
+#include "lib/logging.hpp"
+
+using namespace otto;
+
+int main(int argc, char* argv[])
+{
+  bool show_help = false;
+  bool list = false;
+  std::string json_path;
+  std::string filter;
+
+  auto cli = lyra::cli_parser() | lyra::help(show_help)
+             | lyra::opt(json_path, "file")["-j"]["--json"]("Write the results as JSON to this file")
+             | lyra::opt(filter, "name")["-f"]["--filter"]("Only run groups with this in their name")
+             | lyra::opt(list)["-l"]["--list"]("List the benchmark groups");
+  auto result = cli.parse({argc, argv});
+  if (!result) {
+    std::cerr << result.errorMessage() << std::endl << cli << std::endl;
+    return 1;
+  }
+  if (show_help) {
+    std::cout << cli << std::endl;
+    return 0;
+  }
+  if (list) {
+    for (const auto& b : bench::registry()) std::cout << b.name << std::endl;
+    return 0;
+  }
+
+  logging::init();
+  gam::sampleRate(44100);
+
+  // One Bench for all groups, so all results end up in the same JSON output
+  bench::Bench bench;
+  bench.warmup(100).minEpochIterations(100);
+  for (const auto& b : bench::registry()) {
+    if (!filter.empty() && b.name.find(filter) == std::string_view::npos) continue;
+    bench.title(std::string(b.name)).unit("op").batch(1).relative(false);
+    b.run(bench);
+  }
+
+  if (!json_path.empty()) {
+    std::ofstream out(json_path);
+    ankerl::nanobench::render(ankerl::nanobench::templates::json(), bench, out);
+    LOGI("Wrote results to {}", json_path);
+  }
+  return 0;
+}
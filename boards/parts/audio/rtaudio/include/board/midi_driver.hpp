@@ -4,6 +4,7 @@
 
 #include "lib/util/algorithm.hpp"
 
+#include "lib/chrono.hpp"
 #include "lib/logging.hpp"
 #include "lib/midi.hpp"
 
@@ -28,7 +29,7 @@ namespace otto {
           auto& self = *static_cast<RtMidiDriver*>(userdata);
           try {
             auto e = midi::from_bytes(*message);
-            self.midi_.send_event(e);
+            self.midi_.send_event(e, self.timestamp(timestamp));
           } catch (std::exception& e) {
             LOGE("{}", e.what());
           }
@@ -42,6 +43,22 @@ namespace otto {
     }
 
   private:
+    /// Convert the RtMidi timestamp to a time point.
+    ///
+    /// RtMidi timestamps are the seconds since the previous message. They are used to keep
+    /// the spacing of messages that are delivered in bursts, but an event is never placed
+    /// after the time it was received, or more than `max_delay` before it.
+    chrono::time_point timestamp(double delta) noexcept
+    {
+      constexpr chrono::duration max_delay = 10ms;
+      const auto now = chrono::clock::now();
+      auto res = last_event_time_ + chrono::duration_cast<chrono::duration>(std::chrono::duration<double>(delta));
+      res = std::clamp(res, now - max_delay, now);
+      last_event_time_ = res;
+      return res;
+    }
+
+    chrono::time_point last_event_time_ = {};
     drivers::MidiController& midi_;
     RtMidiIn midi_in_ = {RtMidi::Api::UNSPECIFIED, "OTTO"};
   };
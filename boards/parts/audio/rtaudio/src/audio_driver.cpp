@@ -132,7 +132,7 @@ namespace otto::drivers {
   void RtAudioDriver::init_audio()
   {
     RtAudio::StreamOptions opts;
-    opts.flags = RTAUDIO_SCHEDULE_REALTIME;
+    opts.flags = RTAUDIO_SCHEDULE_REALTIME | RTAUDIO_NONINTERLEAVED;
     opts.numberOfBuffers = 1;
     opts.streamName = "OTTO";
     unsigned samplerate = conf.sample_rate;
@@ -143,42 +143,39 @@ namespace otto::drivers {
                                                               static_cast<int>(nframes), time, status);
       },
       this, &opts);
-    buffers.resize(buffer_size_ * 4);
+    // Only used for mono or missing input
+    buffers.resize(buffer_size_ * 2);
     LOGI("Buffer size: {}", buffer_size_);
   }
 
   int RtAudioDriver::rtaudio_cb(float* out, float* in, int nframes, double time, RtAudioStreamStatus status) noexcept
   {
-    if (status != 0) LOGE("Audio Over/undrerun!");
-    auto input_buf = util::stereo_audio_buffer(
-      util::audio_buffer(std::span(buffers.data() + 0 * buffer_size_, buffer_size_), nullptr),
-      util::audio_buffer(std::span(buffers.data() + 1 * buffer_size_, buffer_size_), nullptr));
-    auto output_buf = util::stereo_audio_buffer(
-      util::audio_buffer(std::span(buffers.data() + 2 * buffer_size_, buffer_size_), nullptr),
-      util::audio_buffer(std::span(buffers.data() + 3 * buffer_size_, buffer_size_), nullptr));
-    CallbackData cbd = {
-      .input = input_buf,
-      .output = output_buf,
-    };
-    // Deinterleave and copy input audio
+    const auto n = static_cast<std::size_t>(nframes);
+    // The stream is non-interleaved, so the output channels are written directly by the callback
+    auto output_buf = util::stereo_audio_buffer(util::audio_buffer(std::span(out, n), nullptr),
+                                                util::audio_buffer(std::span(out + n, n), nullptr));
+    float* in_left = buffers.data();
+    float* in_right = buffers.data() + buffer_size_;
     if (i_params.nChannels == 2) {
-      for (int i = 0; i < nframes; i++) {
-        input_buf.left[i] = in[i * 2];
-        input_buf.right[i] = in[i * 2 + 1];
-      }
+      in_left = in;
+      in_right = in + n;
     } else if (i_params.nChannels == 1) {
-      std::copy_n(in, nframes, input_buf.left.begin());
-      std::copy_n(in, nframes, input_buf.right.begin());
+      std::copy_n(in, n, in_left);
+      std::copy_n(in, n, in_right);
     } else if (i_params.nChannels == 0) {
-      input_buf.clear();
+      std::fill_n(in_left, n, 0.f);
+      std::fill_n(in_right, n, 0.f);
     }
+    auto input_buf = util::stereo_audio_buffer(util::audio_buffer(std::span(in_left, n), nullptr),
+                                               util::audio_buffer(std::span(in_right, n), nullptr));
+    CallbackData cbd = {
+      .input = input_buf,
+      .output = output_buf,
+      // Counted in the timing statistics of the audio service, logging is not realtime safe
+      .xrun = status != 0,
+    };
     OTTO_ASSERT(callback != nullptr);
     callback(cbd);
-    // Interleave audio
-    for (int i = 0; i < nframes; i++) {
-      out[i * 2] = cbd.output.left[i];
-      out[i * 2 + 1] = cbd.output.right[i];
-    }
     return 0;
   }
 
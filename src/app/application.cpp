@@ -1,5 +1,6 @@
 #include "application.hpp"
 
+#include "lib/audio_graph.hpp"
 #include "lib/voices/voice_manager.hpp"
 
 #include "app/engines/master/master.hpp"
@@ -33,7 +34,8 @@ namespace otto {
     Controller controller(rt, confman);
     Graphics graphics(rt);
     Audio audio;
-    StateManager stateman("data/state.json");
+    // Binary, so it is quick to read at boot. The state is read from data/state.json if this does not exist yet.
+    StateManager stateman("data/state.cbor");
 
     // Key/LED Layers
     LayerStack layers;
@@ -65,7 +67,7 @@ namespace otto {
     // Sound slots
     itc::Context soundslots_ctx;
     auto sound_slots = engines::slots::SoundSlots::make(soundslots_ctx);
-    sound_slots.logic->set_managed(std::ref(ctx));
+    sound_slots.logic->set_managed(ctx);
     nav_km.bind_nav_key(Key::slots, sound_slots.overlay_screen);
     stateman.add("Sound Slots", std::ref(soundslots_ctx));
 
@@ -73,20 +75,52 @@ namespace otto {
     RtMidiDriver rt_midi_driver(audio.midi());
     LedManager ledman(controller.port_writer());
 
-    // Start services
-    auto stop_midi = audio.set_midi_handler(&*midifx_eng.audio);
-    auto stop_audio = audio.set_process_callback([&](Audio::CallbackData data) {
-      midifx_eng.audio->process();
-      const auto res = eng.audio->process();
-      stdr::copy(util::zip(res, res), data.output.begin());
-    });
-    auto stop_input = controller.set_input_handler(layers);
-    auto stop_graphics = graphics.show([&](skia::Canvas& ctx) {
-      ledman.process(layers);
-      nav_km.nav().draw(ctx);
-    });
+    // Audio graph
+    // The arp notes of the current block, placed at their frame offsets by the synth
+    std::span<const midi::TimedMidiEvent> arp_events;
+    AudioGraph graph;
+    AudioGraph::NodeId synth_node = 0;
+    auto midifx_node =
+      graph.add_node("midi-fx", [&](std::size_t nframes) noexcept { arp_events = midifx_eng.audio->process(nframes); });
+    synth_node = graph.add_node(
+      "synth",
+      [&](std::size_t) noexcept {
+        util::stereo_audio_buffer output = {graph.output(synth_node, 0), graph.output(synth_node, 1)};
+        eng.audio->process_timed(output, util::MixMode::replace, arp_events);
+      },
+      2);
+    graph.connect(midifx_node, synth_node);
+    audio.compile_graph(graph);
+
+    // Start services. Each handler is handed to the thread of its service by a task, which hops between
+    // the threads, so none of them is parked waiting for another. Only this thread waits, until all are
+    // started. The handlers are removed again when `started` is destroyed, in the reverse order.
+    struct Started {
+      util::at_exit midi;
+      util::at_exit audio;
+      util::at_exit input;
+      util::at_exit graphics;
+    };
+    auto start = [&]() -> itc::Task<Started> {
+      auto stop_midi = co_await audio.set_midi_handler_async(&*midifx_eng.audio);
+      auto stop_audio = co_await audio.set_process_callback_async([&](Audio::CallbackData data) {
+        // The synth renders straight into the driver's memory
+        graph.bind_output(synth_node, 0, {data.output.left.data(), data.output.left.size()});
+        graph.bind_output(synth_node, 1, {data.output.right.data(), data.output.right.size()});
+        graph.process(data.output.size());
+      });
+      auto stop_input = co_await controller.set_input_handler_async(layers);
+      auto stop_graphics = co_await graphics.show_async([&](skia::Canvas& ctx) {
+        ledman.process(layers);
+        nav_km.nav().draw(ctx);
+      });
+      co_return Started{std::move(stop_midi), std::move(stop_audio), std::move(stop_input), std::move(stop_graphics)};
+    };
+    auto started = start().sync_wait();
 
     stateman.read_from_file();
+    // Journal changes as they happen, so they survive a crash or power loss
+    stateman.start_autosave(logic_thread.executor());
 
     // Run
     rt.wait_for_stop();
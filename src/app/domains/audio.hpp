@@ -11,6 +11,7 @@ namespace otto::services {
 namespace otto {
 
   struct AudioDomain : itc::StaticDomain<struct audio_domain_tag> {
+    /// The pool the audio graph takes its buffers from, see `services::Audio::compile_graph`
     static util::AudioBufferPool& buffer_pool() noexcept
     {
       OTTO_ASSERT(buffer_pool_.has_value());
@@ -4,6 +4,8 @@
 
 #include "lib/util/audio_buffer.hpp"
 
+#include "lib/chrono.hpp"
+
 namespace otto::drivers {
   struct IAudioDriver;
   struct IAudioMixer {
@@ -20,6 +22,8 @@ namespace otto::drivers {
     struct CallbackData {
       const util::stereo_audio_buffer& input;
       util::stereo_audio_buffer& output;
+      /// Set by the driver if an over/underrun happened since the last callback
+      bool xrun = false;
     };
     using Callback = fu2::unique_function<void(CallbackData in)>;
 
@@ -32,6 +36,14 @@ namespace otto::drivers {
     [[nodiscard]] virtual std::size_t sample_rate() const = 0;
     virtual IAudioMixer& mixer() = 0;
 
+    /// The time at the start of the current callback.
+    ///
+    /// Midi event timestamps are relative to this clock.
+    [[nodiscard]] virtual chrono::time_point now() const
+    {
+      return chrono::clock::now();
+    }
+
     static std::unique_ptr<IAudioDriver> make_default();
   };
 } // namespace otto::drivers
@@ -1,19 +1,33 @@
 #pragma once
 
+#include <algorithm>
 #include <bitset>
+#include <span>
 
 #include <concurrentqueue.h>
 
+#include "lib/util/local_vector.hpp"
 #include "lib/util/smart_ptr.hpp"
 
+#include "lib/chrono.hpp"
 #include "lib/midi.hpp"
 
 namespace otto::drivers {
 
   struct MidiController {
+    /// Send an event, timestamped with the current time
     void send_event(midi::MidiEvent e) noexcept
     {
-      midi_queue_.enqueue(e);
+      send_event(e, chrono::clock::now());
+    }
+
+    /// Send an event that was received at `time`.
+    ///
+    /// The timestamp is converted to a frame offset in the audio block the event
+    /// is processed in.
+    void send_event(midi::MidiEvent e, chrono::time_point time) noexcept
+    {
+      midi_queue_.enqueue({e, time});
     }
 
     const std::bitset<128>& key_states() noexcept
@@ -22,13 +36,23 @@ namespace otto::drivers {
     }
 
   protected:
+    struct QueuedEvent {
+      midi::MidiEvent event;
+      chrono::time_point time;
+    };
+
     MidiController() = default;
-    moodycamel::ConcurrentQueue<midi::MidiEvent> midi_queue_;
+    moodycamel::ConcurrentQueue<QueuedEvent> midi_queue_;
     util::smart_ptr<midi::IMidiHandler> midi_handler_;
     std::bitset<128> key_states_;
   };
 
   struct MidiDriver : private MidiController {
+    /// The maximum number of events handled in one audio block.
+    ///
+    /// Remaining events are left in the queue for the next block.
+    static constexpr std::size_t max_events_per_block = 256;
+
     void set_handler(util::smart_ptr<midi::IMidiHandler> h) noexcept
     {
       midi_handler_ = std::move(h);
@@ -39,18 +63,56 @@ namespace otto::drivers {
       return *this;
     }
 
+    /// Dispatch all queued events immediately, ignoring their timestamps
     void process_events(int max = -1)
     {
-      midi::MidiEvent evt;
+      QueuedEvent evt;
       for (unsigned i = 0; max < 0 || i < max; i++) {
         if (!midi_queue_.try_dequeue(evt)) break;
-        std::visit(util::overloaded([&](midi::NoteOn& e) { key_states_[e.note] = true; },
-                                    [&](midi::NoteOff& e) { key_states_[e.note] = false; }, //
-                                    [](auto&&) {}),
-                   evt);
-        if (midi_handler_) midi_handler_->handle(evt);
+        dispatch(evt.event);
       }
     }
+
+    /// Dequeue events, and schedule them in an audio block of `nframes` frames.
+    ///
+    /// Events are delayed by exactly one block: an event received at time `t` is
+    /// scheduled at the offset `t - block_start` in the block, where `block_start`
+    /// is the start of the period the previous block was playing in.
+    /// This adds a constant latency instead of up to one block of jitter.
+    ///
+    /// @return the scheduled events, sorted by frame offset
+    std::span<const midi::TimedMidiEvent> collect_events(chrono::time_point block_start,
+                                                         std::size_t nframes,
+                                                         std::size_t sample_rate) noexcept
+    {
+      scheduled_.clear();
+      QueuedEvent evt;
+      while (!scheduled_.full() && midi_queue_.try_dequeue(evt)) {
+        const double frame = std::chrono::duration<double>(evt.time - block_start).count() * double(sample_rate);
+        midi::TimedMidiEvent te = {
+          .event = evt.event,
+          .frame = static_cast<std::size_t>(std::clamp(frame, 0.0, double(nframes - 1))),
+        };
+        // Events from one source arrive in order, so this is usually an append.
+        // Events at the same frame keep their queue order.
+        auto* pos = std::ranges::upper_bound(scheduled_, te.frame, std::less<>(), &midi::TimedMidiEvent::frame);
+        scheduled_.insert_before(pos, te);
+      }
+      return {scheduled_.begin(), scheduled_.end()};
+    }
+
+    /// Update the key states and pass the event on to the handler
+    void dispatch(const midi::MidiEvent& evt)
+    {
+      std::visit(util::overloaded([&](const midi::NoteOn& e) { key_states_[e.note] = true; },
+                                  [&](const midi::NoteOff& e) { key_states_[e.note] = false; }, //
+                                  [](auto&&) {}),
+                 evt);
+      if (midi_handler_) midi_handler_->handle(midi::MidiEvent(evt));
+    }
+
+  private:
+    util::local_vector<midi::TimedMidiEvent, max_events_per_block> scheduled_;
   };
 
 } // namespace otto::drivers
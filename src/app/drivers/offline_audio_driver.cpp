@@ -0,0 +1,103 @@
+#include "offline_audio_driver.hpp"
+
+namespace otto::drivers {
+
+  OfflineAudioDriver::OfflineAudioDriver(std::size_t buffer_size, std::size_t sample_rate)
+    : buffer_size_(buffer_size), sample_rate_(sample_rate), buffers_(4 * buffer_size, 0.f)
+  {}
+
+  OfflineAudioDriver::~OfflineAudioDriver() noexcept
+  {
+    stop();
+  }
+
+  void OfflineAudioDriver::set_callback(Callback&& cb)
+  {
+    std::scoped_lock l(mutex_);
+    callback_ = std::move(cb);
+  }
+
+  void OfflineAudioDriver::start()
+  {
+    idle_thread_ = std::jthread([this](const std::stop_token& stop) {
+      const auto period = std::chrono::duration<double>(double(buffer_size_) / double(sample_rate_));
+      while (!stop.stop_requested()) {
+        {
+          std::scoped_lock l(mutex_);
+          run_callback(buffer_size_);
+        }
+        std::this_thread::sleep_for(period);
+      }
+    });
+  }
+
+  void OfflineAudioDriver::stop()
+  {
+    idle_thread_.request_stop();
+    if (idle_thread_.joinable()) idle_thread_.join();
+  }
+
+  std::size_t OfflineAudioDriver::buffer_size() const noexcept
+  {
+    return buffer_size_;
+  }
+
+  std::size_t OfflineAudioDriver::sample_rate() const noexcept
+  {
+    return sample_rate_;
+  }
+
+  IAudioMixer& OfflineAudioDriver::mixer() noexcept
+  {
+    return mixer_;
+  }
+
+  chrono::time_point OfflineAudioDriver::now() const noexcept
+  {
+    return time_of(frame());
+  }
+
+  chrono::time_point OfflineAudioDriver::time_of(std::size_t frame) const noexcept
+  {
+    const auto offset = std::chrono::duration<double>(double(frame) / double(sample_rate_));
+    return start_time_ + chrono::duration_cast<chrono::duration>(offset);
+  }
+
+  std::size_t OfflineAudioDriver::frame() const noexcept
+  {
+    return frame_.load(std::memory_order_relaxed);
+  }
+
+  void OfflineAudioDriver::render(std::size_t nframes, BlockFunc before_block, SinkFunc sink)
+  {
+    std::scoped_lock l(mutex_);
+    for (std::size_t done = 0; done < nframes;) {
+      const std::size_t n = std::min(buffer_size_, nframes - done);
+      before_block(frame());
+      auto output = run_callback(n);
+      for (auto& s : output.left) s *= mixer_.volume;
+      for (auto& s : output.right) s *= mixer_.volume;
+      sink(output);
+      frame_.fetch_add(n, std::memory_order_relaxed);
+      done += n;
+    }
+  }
+
+  util::audio_buffer OfflineAudioDriver::channel(std::size_t idx, std::size_t n) noexcept
+  {
+    return util::audio_buffer(std::span(buffers_.data() + idx * buffer_size_, n), nullptr);
+  }
+
+  util::stereo_audio_buffer OfflineAudioDriver::run_callback(std::size_t n)
+  {
+    const auto input = util::stereo_audio_buffer(channel(0, n), channel(1, n));
+    auto output = util::stereo_audio_buffer(channel(2, n), channel(3, n));
+    if (callback_) {
+      callback_({.input = input, .output = output});
+    } else {
+      output.clear();
+    }
+    return output;
+  }
+
+} // namespace otto::drivers
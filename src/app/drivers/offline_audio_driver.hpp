@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <function2/function2.hpp>
+
+#include "app/drivers/audio_driver.hpp"
+
+namespace otto::drivers {
+
+  /// An audio driver that is not tied to a sound card or to wall-clock time.
+  ///
+  /// `render` runs the callback back to back on the calling thread, as fast as possible,
+  /// and advances a virtual clock by one buffer per callback. Midi events should be
+  /// timestamped with `time_of`, so they are scheduled relative to the rendered frames.
+  ///
+  /// Between renders, the callback is run on a background thread once per buffer period,
+  /// with the clock stopped and the output discarded. This keeps the executor of the
+  /// audio service running, so its `sync` works as usual.
+  struct OfflineAudioDriver final : IAudioDriver {
+    /// Called before each buffer with the frame it starts at
+    using BlockFunc = fu2::function_view<void(std::size_t frame)>;
+    /// Called with each rendered buffer. The last buffer may be shorter than `buffer_size()`.
+    using SinkFunc = fu2::function_view<void(const util::stereo_audio_buffer& output)>;
+
+    explicit OfflineAudioDriver(std::size_t buffer_size = 256, std::size_t sample_rate = 44100);
+    ~OfflineAudioDriver() noexcept override;
+
+    void set_callback(Callback&& cb) override;
+    void start() override;
+    void stop() override;
+    [[nodiscard]] std::size_t buffer_size() const noexcept override;
+    [[nodiscard]] std::size_t sample_rate() const noexcept override;
+    IAudioMixer& mixer() noexcept override;
+
+    /// The virtual time of the current frame
+    [[nodiscard]] chrono::time_point now() const noexcept override;
+
+    /// The virtual time of `frame`
+    [[nodiscard]] chrono::time_point time_of(std::size_t frame) const noexcept;
+
+    /// The number of frames rendered so far
+    [[nodiscard]] std::size_t frame() const noexcept;
+
+    /// Render `nframes` frames as fast as possible.
+    void render(std::size_t nframes, BlockFunc before_block, SinkFunc sink);
+
+  private:
+    struct Mixer final : IAudioMixer {
+      void set_volume(float v) override
+      {
+        volume = v;
+      }
+      [[nodiscard]] float get_volume() const override
+      {
+        return volume;
+      }
+      float volume = 1.f;
+    };
+
+    /// A view of the first `n` frames of channel `idx` of the buffers
+    util::audio_buffer channel(std::size_t idx, std::size_t n) noexcept;
+    /// Run the callback on the first `n` frames of the buffers, returning the output
+    util::stereo_audio_buffer run_callback(std::size_t n);
+
+    std::size_t buffer_size_;
+    std::size_t sample_rate_;
+    chrono::time_point start_time_ = chrono::clock::now();
+    std::atomic<std::size_t> frame_ = 0;
+    Callback callback_;
+    Mixer mixer_;
+    /// Input left, input right, output left, output right
+    std::vector<float> buffers_;
+    /// Held while the callback runs, so it is only run from one thread at a time
+    std::mutex mutex_;
+    std::jthread idle_thread_;
+  };
+
+} // namespace otto::drivers
@@ -31,7 +31,10 @@ namespace otto::engines::arp {
     {
       target_ = target;
     }
-    virtual void process() noexcept = 0;
+    /// Advance by `nframes` frames, and return the events that fall in that block, at their frame offsets.
+    ///
+    /// The events are meant for `target()`, and are valid until the next call.
+    virtual std::span<const midi::TimedMidiEvent> process(std::size_t nframes) noexcept = 0;
 
   private:
     midi::IMidiHandler* target_;
@@ -1,3 +1,5 @@
+#include <Gamma/Domain.h>
+
 #include "app/services/audio.hpp"
 
 #include "arp.hpp"
@@ -13,9 +15,11 @@ namespace otto::engines::arp {
     NoteVector current_notes_;
     PlayModeFunc playmode_func_ = play_modes::up;
     OctaveModeFunc octavemode_func_ = octave_modes::standard;
-    // Only temporary
-    std::size_t buffer_count = 0;
-    int buffers_per_beat = 25;
+    /// Frames since the start of the current beat
+    std::size_t frame_in_beat_ = 0;
+    std::size_t frames_per_beat_ = 25 * 256;
+    /// The events of the current block. At the fastest tempo, a block has several beats.
+    util::local_vector<midi::TimedMidiEvent, 256> events_;
 
     // Helper functions
     static void insert_note(NoteArray& notes, std::uint8_t note)
@@ -51,32 +55,43 @@ namespace otto::engines::arp {
       arp_state.invalidate_om_cache();
     };
 
-    void process() noexcept override
+    std::span<const midi::TimedMidiEvent> process(std::size_t nframes) noexcept override
     {
+      events_.clear();
       // TODO: Should be a part of the EngineDispatcher
-      if (!state().active) return;
+      if (!state().active) return events_;
 
-      auto at_beat = [&](std::size_t cnt) { return cnt % buffers_per_beat == 0; };
-      auto at_note_off = [&](std::size_t cnt) {
-        return cnt % buffers_per_beat == static_cast<int>(state().note_length * (buffers_per_beat - 2)) + 1;
+      const auto note_off_frame =
+        1 + static_cast<std::size_t>(state().note_length * static_cast<float>(frames_per_beat_ - 2));
+      const auto send = [&](std::size_t frame, midi::MidiEvent evt) {
+        // Events that do not fit are dropped, rather than sent at the wrong time
+        (void) events_.push_back({.event = evt, .frame = frame});
       };
 
       // Both should check "if(running && ...)"
-      if (at_note_off(buffer_count)) {
-        for (auto note : current_notes_) {
-          target().handle(midi::NoteOff{.note = note});
+      for (std::size_t left = nframes; left > 0;) {
+        const std::size_t frame = nframes - left;
+        if (frame_in_beat_ >= frames_per_beat_) frame_in_beat_ = 0;
+        if (frame_in_beat_ == note_off_frame) {
+          for (auto note : current_notes_) {
+            send(frame, midi::NoteOff{.note = note});
+          }
+          current_notes_.clear();
         }
-        current_notes_.clear();
-      }
-
-      if (at_beat(buffer_count)) {
-        current_notes_ = octavemode_func_(arp_state, notes_, playmode_func_);
-        // Send note-on events to midi stream
-        for (auto note : current_notes_) {
-          target().handle(midi::NoteOn{.note = note, .velocity = 1 << 7});
+        if (frame_in_beat_ == 0) {
+          current_notes_ = octavemode_func_(arp_state, notes_, playmode_func_);
+          // Send note-on events to midi stream
+          for (auto note : current_notes_) {
+            send(frame, midi::NoteOn{.note = note, .velocity = 1 << 7});
+          }
         }
+        // Skip ahead to the next frame where something happens
+        const std::size_t next = frame_in_beat_ < note_off_frame ? note_off_frame : frames_per_beat_;
+        const std::size_t step = std::min(left, next - frame_in_beat_);
+        frame_in_beat_ += step;
+        left -= step;
       }
-      buffer_count++;
+      return events_;
     }
 
     void on_state_change(const State& s) noexcept override
@@ -87,10 +102,8 @@ namespace otto::engines::arp {
         arp_state.invalidate_om_cache();
       }
 
-      constexpr float samples_per_buffer = 256;
-      constexpr int samples_per_minute = 44100 * 60;
-      constexpr float buffers_per_minute = samples_per_minute / samples_per_buffer;
-      buffers_per_beat = buffers_per_minute / state().bpm;
+      const float samples_per_minute = static_cast<float>(gam::sampleRate()) * 60;
+      frames_per_beat_ = std::max(static_cast<std::size_t>(samples_per_minute / state().bpm), std::size_t{2});
     }
   };
 
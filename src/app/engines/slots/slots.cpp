@@ -5,16 +5,25 @@ namespace otto::engines::slots {
   void Logic::on_state_change(const SoundSlotsState& state)
   {
     tl::optional old = idx.old_val();
-    if (idx.check_changed(state.active_idx)) {
-      // Serialize current
-      if (old) data_.json_objects[*old] = util::serialize(_ctx);
-      // Deserialize new
-      util::deserialize_from(data_.json_objects[state.active_idx], _ctx);
+    if (!idx.check_changed(state.active_idx) || managed_ == nullptr) return;
+    // Snapshot current
+    if (old) {
+      auto& snapshot = data_.snapshots[*old];
+      snapshot.clear();
+      util::BinaryWriter out(snapshot);
+      util::serialize_into(out, *managed_);
     }
+    // Apply new. All states are committed in one transaction, so the consumers,
+    // including the audio engines, switch to the new slot at once.
+    const auto& snapshot = data_.snapshots[state.active_idx];
+    if (snapshot.empty()) return;
+    itc::Transaction t;
+    util::BinaryReader in(snapshot);
+    util::deserialize_from(in, *managed_);
   }
 
-  void Logic::set_managed(util::DynSerializable&& ctx)
+  void Logic::set_managed(itc::Context& ctx) noexcept
   {
-    _ctx = std::move(ctx);
+    managed_ = &ctx;
   }
 } // namespace otto::engines::slots
@@ -1,12 +1,15 @@
 #pragma once
 
+#include "lib/util/binary_serialization.hpp"
 #include "lib/util/change_checker.hpp"
 #include "lib/util/serialization.hpp"
 #include "lib/util/with_limits.hpp"
 
 #include "lib/engine.hpp"
 #include "lib/graphics.hpp"
+#include "lib/itc/context.hpp"
 #include "lib/itc/producer.hpp"
+#include "lib/itc/transaction.hpp"
 
 namespace otto::engines::slots {
 
@@ -23,8 +26,10 @@ namespace otto::engines::slots {
 
   // Put in a separate struct because it is not needed for the screen and contains a lot of data.
   struct SlotData {
-    std::array<json::value, 10> json_objects;
-    DECL_VISIT(json_objects);
+    /// Binary snapshots of the managed context. Empty until the slot has been left once.
+    ///
+    /// The buffers keep their capacity, so saving a slot again does not allocate.
+    std::array<std::vector<std::byte>, 10> snapshots;
   };
 
   struct Logic : ILogic, itc::Producer<SoundSlotsState, SlotState> {
@@ -32,10 +37,11 @@ namespace otto::engines::slots {
 
     void on_state_change(const SoundSlotsState& state) override;
     void on_state_change(const SlotState& state) override {}
-    void set_managed(util::DynSerializable&& ctx);
+    /// Set the context whose state is switched between the slots
+    void set_managed(itc::Context& ctx) noexcept;
 
   private:
-    util::DynSerializable _ctx;
+    itc::Context* managed_ = nullptr;
     SlotData data_;
     util::change_checker<int> idx;
   };
@@ -1,129 +1,12 @@
 #include "app/services/audio.hpp"
 
-#include <Gamma/Envelope.h>
-#include <Gamma/Oscillator.h>
-
 #include "lib/voices/voice_manager.hpp"
 
+#include "fm_bank.hpp"
 #include "ottofm.hpp"
+#include "voice.hpp"
 
 namespace otto::engines::ottofm {
-  /// Custom version of the 'Sine' in Gamma. We need to call it with a phase offset
-  /// instead of a frequency offset. (Phase modulation, not frequency modulation)
-  struct FMOperator {
-    struct FMSine : public gam::AccumPhase<> {
-      FMSine(float frq = 440, float phs = 0) : AccumPhase<>(frq, phs, 1) {}
-      /// Generate next sample with phase offset
-      float operator()(float phsOffset) noexcept
-      {
-        return gam::scl::sinP9(gam::scl::wrap(this->nextPhase() + phsOffset, 1.f, -1.f));
-      }
-    };
-
-    FMOperator(const OperatorState& state) : state(state) {}
-
-    float operator()(float phaseMod = 0) noexcept
-    {
-      previous_value_ = sine(phaseMod + feedback_ * previous_value_) * env_() * state.level;
-      return previous_value_;
-    }
-
-    /// Set frequency
-    void freq(float frq) noexcept
-    {
-      sine.freq(frq * freq_ratio_ + detune_amount_);
-    }
-
-    /// For graphics
-    [[nodiscard]] float get_activity_level() const noexcept
-    {
-      return env_.value() * state.level;
-    }
-    [[nodiscard]] float get_envelope_stage() const noexcept
-    {
-      if (env_.done()) return 4;
-      if (env_.sustained()) return 2;
-      auto stage = env_.stage();
-      float base = stage == 2 ? 3.f : float(stage);
-      return base + float(env_.position()) / float(env_.lengths()[stage] * env_.spu());
-    }
-
-    /// Reset envelope
-    void reset() noexcept
-    {
-      env_.resetSoft();
-    }
-
-    /// Release envelope
-    void release() noexcept
-    {
-      env_.release();
-    }
-
-    /// Finish envelope
-    void finish() noexcept
-    {
-      env_.finish();
-    }
-
-    void on_state_change() noexcept
-    {
-      env_.attack(envelope_stage_duration(state.envelope.attack));
-      env_.decay(envelope_stage_duration(state.envelope.decay));
-      env_.release(envelope_stage_duration(state.envelope.release));
-      env_.sustain(state.envelope.sustain);
-
-      freq_ratio_ = fractions[state.ratio_idx];
-      // 10 Hz? Should we find something more appropriate?
-      detune_amount_ = 20 * state.detune;
-      feedback_ = (state.shape - 0.5f) * 2.f;
-    }
-
-  private:
-    const OperatorState& state;
-    FMSine sine;
-    gam::ADSR<> env_;
-
-    float freq_ratio_ = 1;
-    float detune_amount_ = 0;
-    float feedback_ = 0;
-    float previous_value_ = 0;
-  };
-
-  struct Voice : voices::VoiceBase<Voice> {
-    Voice(const State& state) noexcept;
-
-    float operator()() noexcept;
-
-    void on_note_on() noexcept;
-    void on_note_off() noexcept;
-
-    void reset_envelopes() noexcept;
-    void release_envelopes() noexcept;
-
-    /// Sets operator frequencies. Call after next() to use updated voice frequency
-    void set_frequencies() noexcept;
-
-    // TODO: maybe add some magic here? (i.e: should Voice also be a consumer of state?)
-    // The answer is probably yes, once each consumer doesn't need its own separate copies
-    // of state, and various other optimizations have been done to make many consumers of
-    // the same state on the same thread cheaper.
-    /// Must be called manually, no magic here!
-    void on_state_change(const State&) noexcept
-    {
-      for (auto& op : operators) {
-        op.on_state_change();
-      }
-    }
-
-    const State& state_;
-    std::array<FMOperator, 4> operators = {
-      state_.operators[0],
-      state_.operators[1],
-      state_.operators[2],
-      state_.operators[3],
-    };
-  };
 
   struct Audio final : AudioDomain, itc::Consumer<State>, itc::Producer<AudioState>, ISynthAudio {
     Audio(itc::Channel& ch) : Consumer(ch), Producer(ch), voice_mgr_(ch, Consumer::state()) {}
@@ -133,10 +16,9 @@ namespace otto::engines::ottofm {
       return voice_mgr_;
     }
 
-    util::audio_buffer process() noexcept override
+    void process(util::stereo_audio_buffer& output, util::MixMode mode) noexcept override
     {
-      auto buf = buffer_pool().allocate();
-      stdr::generate(buf, std::ref(voice_mgr_));
+      voice_bank_.process(voice_mgr_.voices(), output, mode);
       for (auto&& [op, act] : util::zip(voice_mgr_.last_triggered_voice().operators, Producer::state().activity)) {
         act = op.get_activity_level();
       }
@@ -144,7 +26,6 @@ namespace otto::engines::ottofm {
         st = op.get_envelope_stage();
       }
       Producer::commit();
-      return buf;
     }
 
     void on_state_change(const State& s) noexcept override
@@ -154,7 +35,10 @@ namespace otto::engines::ottofm {
 
     friend struct Voice;
 
-    voices::VoiceManager<Voice, 6> voice_mgr_;
+    static constexpr std::size_t voice_count = 6;
+
+    voices::VoiceManager<Voice, voice_count> voice_mgr_;
+    FMVoiceBank<voice_count> voice_bank_;
   };
 
   std::unique_ptr<ISynthAudio> make_audio(itc::Channel& chan)
@@ -170,6 +54,11 @@ namespace otto::engines::ottofm {
     }
   }
 
+  bool Voice::is_idle() const noexcept
+  {
+    return !is_triggered() && std::ranges::all_of(operators, &FMOperator::done);
+  }
+
   void Voice::on_note_on() noexcept
   {
     reset_envelopes();
@@ -192,54 +81,31 @@ namespace otto::engines::ottofm {
 
   void Voice::set_frequencies() noexcept
   {
+    operator_frequency_ = frequency();
     for (auto& op : operators) op.freq(frequency());
   }
 
   float Voice::operator()() noexcept
   {
-    set_frequencies();
-    auto& [op0, op1, op2, op3] = operators;
-    switch (state_.algorithm_idx) {
-      case 0: {
-        return op0(op1(op2(op3(0))));
-      }
-      case 1: {
-        return op0(op1(op2(0) + op3(0)));
-      }
-      case 2: {
-        return op0(op1(op2(0)) + op3(0));
-      }
-      case 3: {
-        float aux = op3(0);
-        return op0(op1(aux) + op2(aux));
-      }
-      case 4: {
-        float aux = op2(op3(0));
-        return (op0(aux) + op1(aux));
-      }
-      case 5: {
-        return (op0(0) + op1(op2(op3(0))));
-      }
-      case 6: {
-        return op0(op1(0) + op2(0) + op3(0));
-      }
-      case 7: {
-        return (op0(op1(0)) + op2(op3(0)));
-      }
-      case 8: {
-        float aux = op3(0);
-        return (op0(aux) + op1(aux) + op2(aux));
-      }
-      case 9: {
-        return (op0(0) + op1(0) + op2(op3(0)));
-      }
-      case 10: {
-        return (op0(0) + op1(0) + op2(0) + op3(0));
-      }
-      default: {
-        return 0.f;
-      }
+    if (frequency() != operator_frequency_) set_frequencies();
+    float res = 0.f;
+    with_algorithm(state_.algorithm_idx, [&](auto alg) { res = next_sample<decltype(alg)::value>(); });
+    return res;
+  }
+
+  void Voice::process(std::span<float> output) noexcept
+  {
+    // Frequencies change every sample while gliding
+    if (is_gliding()) {
+      VoiceBase::process(output);
+      return;
     }
+    calc_next();
+    set_frequencies();
+    const float vol = volume();
+    with_algorithm(state_.algorithm_idx, [&](auto alg) {
+      for (float& f : output) f += next_sample<decltype(alg)::value>() * vol;
+    });
   }
 
 } // namespace otto::engines::ottofm
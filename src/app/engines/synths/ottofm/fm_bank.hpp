@@ -0,0 +1,152 @@
+#pragma once
+
+#include <span>
+
+#include <Gamma/Domain.h>
+
+#include "lib/util/audio_buffer.hpp"
+
+#include "lib/dsp/simd.hpp"
+
+#include "voice.hpp"
+
+namespace otto::engines::ottofm {
+
+  /// Structure-of-arrays evaluation of the operators of `N` voices.
+  ///
+  /// Each voice is a SIMD lane, so each operator is calculated for all voices at once.
+  /// Envelopes, glide and voice allocation stay in the `Voice`s, while the bank replaces
+  /// their sine oscillators. The phases are 32 bit fixed point accumulators, where the
+  /// full integer range is one period.
+  template<std::size_t N>
+  struct FMVoiceBank {
+    static_assert(N <= dsp::simd::lanes, "FMVoiceBank has one lane per voice");
+
+    using float_x8 = dsp::simd::float_x8;
+    using uint32_x8 = dsp::simd::uint32_x8;
+
+    /// Render a block from `voices` into `output`, replacing its contents.
+    ///
+    /// Idle voices are not advanced, and the block is skipped if all voices are idle.
+    ///
+    /// Pass the same voices in the same order every block, since the phases of
+    /// the operators are kept in the bank.
+    void process(std::span<Voice, N> voices, std::span<float> output) noexcept
+    {
+      if (!render(voices, output.size(), [&](std::size_t i, float s) { output[i] = s; })) {
+        std::ranges::fill(output, 0.f);
+      }
+    }
+
+    /// Render a block from `voices` into both channels of `output`
+    void process(std::span<Voice, N> voices, util::stereo_audio_buffer& output, util::MixMode mode) noexcept
+    {
+      bool rendered = false;
+      if (mode == util::MixMode::replace) {
+        rendered = render(voices, output.size(), [&](std::size_t i, float s) {
+          output.left[i] = s;
+          output.right[i] = s;
+        });
+        if (!rendered) output.clear();
+      } else {
+        render(voices, output.size(), [&](std::size_t i, float s) {
+          output.left[i] += s;
+          output.right[i] += s;
+        });
+      }
+    }
+
+  private:
+    /// Calls `write(i, sample)` for each of the `nframes` frames.
+    ///
+    /// @return false if all voices are idle, and nothing was written
+    template<typename Write>
+    bool render(std::span<Voice, N> voices, std::size_t nframes, Write&& write) noexcept
+    {
+      if (std::ranges::all_of(voices, [](const Voice& v) { return v.is_idle(); })) return false;
+
+      float_x8 volume = {};
+      std::array<bool, N> active = {};
+      for (std::size_t v = 0; v < N; v++) {
+        active[v] = !voices[v].is_idle();
+        // Idle lanes are still calculated, but silent and with their phases held
+        if (!active[v]) {
+          for (auto& ops : operators_) {
+            ops.amplitude[v] = 0;
+            ops.phase_inc[v] = 0;
+          }
+          continue;
+        }
+        if (!voices[v].is_gliding()) {
+          voices[v].calc_next();
+          set_frequencies(voices[v], v);
+        }
+        volume[v] = voices[v].volume();
+        for (auto&& [ops, op] : util::zip(operators_, voices[v].operators)) {
+          ops.feedback[v] = op.feedback_;
+        }
+      }
+      with_algorithm(voices[0].state_.algorithm_idx, [&](auto alg) {
+        for (std::size_t i = 0; i < nframes; i++) {
+          for (std::size_t v = 0; v < N; v++) {
+            if (!active[v]) continue;
+            // Gliding voices get new frequencies every sample
+            if (voices[v].is_gliding()) {
+              voices[v].calc_next();
+              set_frequencies(voices[v], v);
+            }
+            for (auto&& [ops, op] : util::zip(operators_, voices[v].operators)) {
+              ops.amplitude[v] = op.envelope() * op.state.level;
+            }
+          }
+          const float_x8 res = algorithm_sample<decltype(alg)::value, float_x8>(
+            [this](int i, float_x8 mod) { return next_sample(operators_[i], mod); });
+          write(i, dsp::simd::horizontal_sum(res * volume));
+        }
+      });
+      return true;
+    }
+
+    /// The state of one operator for all voices
+    struct OperatorLanes {
+      uint32_x8 phase = {};
+      uint32_x8 phase_inc = {};
+      float_x8 feedback = {};
+      float_x8 amplitude = {};
+      float_x8 previous = {};
+    };
+
+    void set_frequencies(const Voice& voice, std::size_t v) noexcept
+    {
+      const double ups = 1.0 / gam::sampleRate();
+      for (auto&& [ops, op] : util::zip(operators_, voice.operators)) {
+        const double freq = voice.frequency() * op.freq_ratio_ + op.detune_amount_;
+        ops.phase_inc[v] = static_cast<std::uint32_t>(static_cast<std::int64_t>(freq * ups * 0x1p32));
+      }
+    }
+
+    /// The same polynomial as `gam::scl::sinP9`, i.e. sin(pi * x) for x in [-1, 1]
+    static float_x8 sin_p9(float_x8 x) noexcept
+    {
+      const float_x8 xx = x * x;
+      return x * (3.1415191f + xx * (-5.1662729f + xx * (2.5422065f + xx * (-0.5811243f + xx * 0.0636716f))));
+    }
+
+    /// The lane equivalent of `FMOperator::operator()`
+    static float_x8 next_sample(OperatorLanes& op, float_x8 phase_mod) noexcept
+    {
+      using namespace dsp::simd;
+      float_x8 offset = phase_mod + op.feedback * op.previous;
+      // Wrap into (-2, 2), so the offset times 2^30 fits in an int32
+      offset = offset - 2.f * to_float(to_int(offset * 0.5f));
+      const uint32_x8 fixed_offset = as_unsigned(to_int(offset * 0x1p30f)) << 1;
+      const float_x8 phase = to_float(as_signed(op.phase + fixed_offset)) * 0x1p-31f;
+      op.phase += op.phase_inc;
+      op.previous = sin_p9(phase) * op.amplitude;
+      return op.previous;
+    }
+
+    std::array<OperatorLanes, 4> operators_;
+  };
+
+} // namespace otto::engines::ottofm
@@ -9,6 +9,7 @@
 #include "lib/graphics.hpp"
 #include "lib/midi.hpp"
 
+#include "app/engines/synths/synth.hpp"
 #include "app/services/graphics.hpp"
 
 #include "state.hpp"
@@ -17,53 +18,9 @@ using namespace otto;
 
 namespace otto::engines::ottofm {
 
-  struct ISynthAudio : IAudioProcessor<util::audio_buffer()> {
-    virtual midi::IMidiHandler& midi_handler() noexcept = 0;
-  };
-
-  struct SynthEngineInstance {
-    std::unique_ptr<ILogic> logic;
-    std::unique_ptr<ISynthAudio> audio;
-    ScreenWithHandler main_screen;
-    ScreenWithHandler mod_screen;
-  };
-
-  struct SynthEngineFactory {
-    fu2::unique_function<std::unique_ptr<ILogic>(itc::Channel&) const> make_logic;
-    fu2::unique_function<std::unique_ptr<ISynthAudio>(itc::Channel&) const> make_audio;
-    fu2::unique_function<ScreenWithHandler(itc::Channel&) const> make_mod_screen;
-    fu2::unique_function<ScreenWithHandler(itc::Channel&) const> make_main_screen;
-
-    SynthEngineInstance make_all(itc::Channel& chan) const
-    {
-      return {
-        .logic = make_logic(chan),
-        .audio = make_audio(chan),
-        .main_screen = make_main_screen(chan),
-        .mod_screen = make_mod_screen(chan),
-      };
-    }
-
-    SynthEngineInstance make_without_audio(itc::Channel& chan) const
-    {
-      return {
-        .logic = make_logic(chan),
-        .audio = nullptr,
-        .main_screen = make_main_screen(chan),
-        .mod_screen = make_mod_screen(chan),
-      };
-    }
-
-    SynthEngineInstance make_without_screens(itc::Channel& chan) const
-    {
-      return {
-        .logic = make_logic(chan),
-        .audio = make_audio(chan),
-        .main_screen = {nullptr, nullptr},
-        .mod_screen = {nullptr, nullptr},
-      };
-    }
-  };
+  using engines::ISynthAudio;
+  using engines::SynthEngineFactory;
+  using engines::SynthEngineInstance;
 
   std::unique_ptr<ILogic> make_logic(itc::Channel&);
   ScreenWithHandler make_main_screen(itc::Channel&);
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <span>
+#include <utility>
+
+#include <Gamma/Envelope.h>
+#include <Gamma/Oscillator.h>
+
+#include "lib/dsp/control_rate.hpp"
+#include "lib/voices/voice_manager.hpp"
+
+#include "ottofm.hpp"
+#include "state.hpp"
+
+namespace otto::engines::ottofm {
+
+  template<std::size_t N>
+  struct FMVoiceBank;
+
+  /// Custom version of the 'Sine' in Gamma. We need to call it with a phase offset
+  /// instead of a frequency offset. (Phase modulation, not frequency modulation)
+  struct FMOperator {
+    struct FMSine : public gam::AccumPhase<> {
+      FMSine(float frq = 440, float phs = 0) : AccumPhase<>(frq, phs, 1) {}
+      /// Generate next sample with phase offset
+      float operator()(float phsOffset) noexcept
+      {
+        return gam::scl::sinP9(gam::scl::wrap(this->nextPhase() + phsOffset, 1.f, -1.f));
+      }
+    };
+
+    FMOperator(const OperatorState& state) : state(state)
+    {
+      env_.domain(dsp::ControlDomain::master());
+    }
+
+    float operator()(float phaseMod = 0) noexcept
+    {
+      previous_value_ = sine(phaseMod + feedback_ * previous_value_) * envelope() * state.level;
+      return previous_value_;
+    }
+
+    /// The next envelope value. The envelope is stepped at control rate, and interpolated in between.
+    float envelope() noexcept
+    {
+      return env_ctl_([this] { return env_(); });
+    }
+
+    /// Set frequency
+    void freq(float frq) noexcept
+    {
+      sine.freq(frq * freq_ratio_ + detune_amount_);
+    }
+
+    /// For graphics
+    [[nodiscard]] float get_activity_level() const noexcept
+    {
+      return env_.value() * state.level;
+    }
+    [[nodiscard]] float get_envelope_stage() const noexcept
+    {
+      if (env_.done()) return 4;
+      if (env_.sustained()) return 2;
+      auto stage = env_.stage();
+      float base = stage == 2 ? 3.f : float(stage);
+      return base + float(env_.position()) / float(env_.lengths()[stage] * env_.spu());
+    }
+
+    /// Whether the envelope has finished, i.e. the operator is silent
+    [[nodiscard]] bool done() const noexcept
+    {
+      return env_.done() && !env_ctl_.is_ramping();
+    }
+
+    /// Reset envelope
+    void reset() noexcept
+    {
+      env_.resetSoft();
+    }
+
+    /// Release envelope
+    void release() noexcept
+    {
+      env_.release();
+    }
+
+    /// Finish envelope
+    void finish() noexcept
+    {
+      env_.finish();
+      env_ctl_.jump(0);
+    }
+
+    void on_state_change() noexcept
+    {
+      env_.attack(envelope_stage_duration(state.envelope.attack));
+      env_.decay(envelope_stage_duration(state.envelope.decay));
+      env_.release(envelope_stage_duration(state.envelope.release));
+      env_.sustain(state.envelope.sustain);
+
+      freq_ratio_ = fractions[state.ratio_idx];
+      // 10 Hz? Should we find something more appropriate?
+      detune_amount_ = 20 * state.detune;
+      feedback_ = (state.shape - 0.5f) * 2.f;
+    }
+
+  private:
+    template<std::size_t N>
+    friend struct FMVoiceBank;
+
+    const OperatorState& state;
+    FMSine sine;
+    gam::ADSR<> env_;
+    dsp::ControlRateValue<float> env_ctl_;
+
+    float freq_ratio_ = 1;
+    float detune_amount_ = 0;
+    float feedback_ = 0;
+    float previous_value_ = 0;
+  };
+
+  struct Voice : voices::VoiceBase<Voice> {
+    Voice(const State& state) noexcept;
+
+    /// The number of operator algorithms
+    static constexpr int algorithm_count = 11;
+
+    float operator()() noexcept;
+
+    /// Render a block, with the frequencies and algorithm selected once per block
+    /// when not gliding
+    void process(std::span<float> output) noexcept;
+
+    /// Released, and all operator envelopes are done
+    [[nodiscard]] bool is_idle() const noexcept;
+
+    void on_note_on() noexcept;
+    void on_note_off() noexcept;
+
+    void reset_envelopes() noexcept;
+    void release_envelopes() noexcept;
+
+    /// Sets operator frequencies. Call after next() to use updated voice frequency
+    void set_frequencies() noexcept;
+
+    // TODO: maybe add some magic here? (i.e: should Voice also be a consumer of state?)
+    // The answer is probably yes, once each consumer doesn't need its own separate copies
+    // of state, and various other optimizations have been done to make many consumers of
+    // the same state on the same thread cheaper.
+    /// Must be called manually, no magic here!
+    void on_state_change(const State&) noexcept
+    {
+      for (auto& op : operators) {
+        op.on_state_change();
+      }
+      set_frequencies();
+    }
+
+    /// Calculate the next sample using the given algorithm
+    template<int Algorithm>
+    float next_sample() noexcept;
+
+    const State& state_;
+    /// The voice frequency the operator frequencies were last set for
+    float operator_frequency_ = 0;
+    std::array<FMOperator, 4> operators = {
+      state_.operators[0],
+      state_.operators[1],
+      state_.operators[2],
+      state_.operators[3],
+    };
+  };
+
+  /// Call `f` with `std::integral_constant<int, idx>` for the algorithm index `idx`
+  template<typename F>
+  void with_algorithm(int idx, F&& f) noexcept
+  {
+    [&]<int... Is>(std::integer_sequence<int, Is...>)
+    {
+      ((idx == Is ? (f(std::integral_constant<int, Is>()), true) : false) || ...);
+    }
+    (std::make_integer_sequence<int, Voice::algorithm_count>());
+  }
+
+  /// Calculate one sample of an operator algorithm.
+  ///
+  /// `op(i, mod)` calculates the next sample of operator `i` with phase modulation `mod`.
+  /// Works on single samples as well as on lanes of samples.
+  template<int Algorithm, typename T, typename Op>
+  T algorithm_sample(Op&& op) noexcept
+  {
+    const T zero = {};
+    if constexpr (Algorithm == 0) {
+      return op(0, op(1, op(2, op(3, zero))));
+    } else if constexpr (Algorithm == 1) {
+      return op(0, op(1, op(2, zero) + op(3, zero)));
+    } else if constexpr (Algorithm == 2) {
+      return op(0, op(1, op(2, zero)) + op(3, zero));
+    } else if constexpr (Algorithm == 3) {
+      T aux = op(3, zero);
+      return op(0, op(1, aux) + op(2, aux));
+    } else if constexpr (Algorithm == 4) {
+      T aux = op(2, op(3, zero));
+      return (op(0, aux) + op(1, aux));
+    } else if constexpr (Algorithm == 5) {
+      return (op(0, zero) + op(1, op(2, op(3, zero))));
+    } else if constexpr (Algorithm == 6) {
+      return op(0, op(1, zero) + op(2, zero) + op(3, zero));
+    } else if constexpr (Algorithm == 7) {
+      return (op(0, op(1, zero)) + op(2, op(3, zero)));
+    } else if constexpr (Algorithm == 8) {
+      T aux = op(3, zero);
+      return (op(0, aux) + op(1, aux) + op(2, aux));
+    } else if constexpr (Algorithm == 9) {
+      return (op(0, zero) + op(1, zero) + op(2, op(3, zero)));
+    } else if constexpr (Algorithm == 10) {
+      return (op(0, zero) + op(1, zero) + op(2, zero) + op(3, zero));
+    } else {
+      return zero;
+    }
+  }
+
+  template<int Algorithm>
+  float Voice::next_sample() noexcept
+  {
+    return algorithm_sample<Algorithm, float>([this](int i, float mod) { return operators[i](mod); });
+  }
+
+} // namespace otto::engines::ottofm
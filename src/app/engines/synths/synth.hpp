@@ -0,0 +1,92 @@
+#pragma once
+
+#include <function2/function2.hpp>
+
+#include "lib/util/audio_buffer.hpp"
+
+#include "lib/audio.hpp"
+#include "lib/engine.hpp"
+#include "lib/graphics.hpp"
+#include "lib/itc/itc.hpp"
+#include "lib/midi.hpp"
+
+namespace otto::engines {
+
+  /// Renders a block into `output`, which has the length of the block.
+  ///
+  /// The output is typically the driver buffer, or a view of it.
+  struct ISynthAudio : IAudioProcessor<void(util::stereo_audio_buffer& output, util::MixMode mode)> {
+    virtual midi::IMidiHandler& midi_handler() noexcept = 0;
+
+    /// Block until the engine has loaded what it needs to make sound.
+    ///
+    /// Engines that load resources in the background render silence until they are loaded.
+    /// This is for offline rendering, never call it on the audio thread.
+    virtual void wait_until_ready() noexcept {}
+
+    /// Render `output`, sending each of `events` to `midi_handler()` at its frame offset.
+    ///
+    /// The block is split at the offsets of the events, which must be sorted.
+    void process_timed(util::stereo_audio_buffer& output, util::MixMode mode,
+                       std::span<const midi::TimedMidiEvent> events) noexcept
+    {
+      std::size_t frame = 0;
+      const auto render_until = [&](std::size_t end) {
+        if (end <= frame) return;
+        auto block = output.slice(frame, end - frame);
+        process(block, mode);
+        frame = end;
+      };
+      for (const auto& evt : events) {
+        render_until(std::min(evt.frame, output.size()));
+        midi_handler().handle(midi::MidiEvent(evt.event));
+      }
+      render_until(output.size());
+    }
+  };
+
+  struct SynthEngineInstance {
+    std::unique_ptr<ILogic> logic;
+    std::unique_ptr<ISynthAudio> audio;
+    ScreenWithHandler main_screen;
+    ScreenWithHandler mod_screen;
+  };
+
+  struct SynthEngineFactory {
+    fu2::unique_function<std::unique_ptr<ILogic>(itc::Channel&) const> make_logic;
+    fu2::unique_function<std::unique_ptr<ISynthAudio>(itc::Channel&) const> make_audio;
+    fu2::unique_function<ScreenWithHandler(itc::Channel&) const> make_mod_screen;
+    fu2::unique_function<ScreenWithHandler(itc::Channel&) const> make_main_screen;
+
+    SynthEngineInstance make_all(itc::Channel& chan) const
+    {
+      return {
+        .logic = make_logic(chan),
+        .audio = make_audio(chan),
+        .main_screen = make_main_screen(chan),
+        .mod_screen = make_mod_screen(chan),
+      };
+    }
+
+    SynthEngineInstance make_without_audio(itc::Channel& chan) const
+    {
+      return {
+        .logic = make_logic(chan),
+        .audio = nullptr,
+        .main_screen = make_main_screen(chan),
+        .mod_screen = make_mod_screen(chan),
+      };
+    }
+
+    SynthEngineInstance make_without_screens(itc::Channel& chan) const
+    {
+      return {
+        .logic = make_logic(chan),
+        .audio = make_audio(chan),
+        .main_screen = {nullptr, nullptr},
+        .mod_screen = {nullptr, nullptr},
+      };
+    }
+  };
+
+} // namespace otto::engines
@@ -0,0 +1,95 @@
+#include <atomic>
+#include <thread>
+
+#include "lib/logging.hpp"
+#include "lib/util/exception.hpp"
+#include "lib/voices/voice_manager.hpp"
+
+#include "app/services/audio.hpp"
+
+#include "voice.hpp"
+#include "wavetable.hpp"
+
+namespace otto::engines::wavetable {
+
+  using Tables = std::vector<dsp::Wavetable>;
+
+  namespace {
+    /// Load and band-limit the wav files in `dir`, in file name order
+    Tables load_tables(const std::filesystem::path& dir, const std::stop_token& stop)
+    {
+      std::vector<std::filesystem::path> paths;
+      std::error_code ec;
+      for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".wav") paths.push_back(entry.path());
+      }
+      if (ec) LOGE("Could not read wavetables from {}: {}", dir, ec.message());
+      std::ranges::sort(paths);
+      Tables res;
+      res.reserve(paths.size());
+      for (const auto& p : paths) {
+        if (stop.stop_requested()) break;
+        try {
+          res.push_back(dsp::Wavetable::load(p));
+        } catch (std::exception& e) {
+          LOGW("Skipping wavetable {}: {}", p, e.what());
+        }
+      }
+      return res;
+    }
+  } // namespace
+
+  struct Audio final : AudioDomain, itc::Consumer<State>, ISynthAudio {
+    Audio(itc::Channel& ch, std::filesystem::path dir)
+      : Consumer(ch),
+        voice_mgr_(ch, Consumer::state()),
+        loader_([this, dir = std::move(dir)](const std::stop_token& stop) {
+          loaded_tables_ = load_tables(dir, stop);
+          LOGI("Loaded {} wavetables from {}", loaded_tables_.size(), dir);
+          loaded_.store(true, std::memory_order_release);
+          loaded_.notify_all();
+        })
+    {}
+
+    midi::IMidiHandler& midi_handler() noexcept override
+    {
+      return voice_mgr_;
+    }
+
+    void process(util::stereo_audio_buffer& output, util::MixMode mode) noexcept override
+    {
+      // The tables are not modified after they are loaded, so all voices read them without locks
+      if (tables_.empty() && loaded_.load(std::memory_order_acquire)) tables_ = loaded_tables_;
+      bank_.process(voice_mgr_.voices(), tables_, output, mode);
+    }
+
+    void on_state_change(const State& s) noexcept override
+    {
+      for (auto& v : voice_mgr_) v.on_state_change(s);
+    }
+
+    void wait_until_ready() noexcept override
+    {
+      loaded_.wait(false, std::memory_order_acquire);
+    }
+
+  private:
+    static constexpr std::size_t voice_count = 6;
+
+    voices::VoiceManager<Voice, voice_count> voice_mgr_;
+    WavetableVoiceBank<voice_count> bank_;
+
+    /// Written by the loader thread before `loaded_` is set
+    Tables loaded_tables_;
+    std::atomic<bool> loaded_ = false;
+    /// The tables used on the audio thread, empty until they are loaded
+    std::span<const dsp::Wavetable> tables_;
+    std::jthread loader_;
+  };
+
+  std::unique_ptr<ISynthAudio> make_audio(itc::Channel& chan)
+  {
+    return std::make_unique<Audio>(chan, default_wavetable_dir);
+  }
+
+} // namespace otto::engines::wavetable
@@ -0,0 +1,140 @@
+#include <array>
+#include <string>
+#include <utility>
+
+#include <fmt/format.h>
+
+#include "lib/util/eventdivider.hpp"
+
+#include "lib/itc/itc.hpp"
+#include "lib/skia/skia.hpp"
+#include "lib/widget.hpp"
+
+#include "app/input.hpp"
+#include "app/services/graphics.hpp"
+
+#include "wavetable.hpp"
+
+namespace otto::engines::wavetable {
+
+  namespace {
+    constexpr float x_pad = 10;
+    constexpr float y_pad = 10;
+
+    /// A label with a value below it, in one of the encoder colors
+    void draw_param(skia::Canvas& ctx, std::string_view label, const std::string& value, skia::Color color,
+                    skia::Point p, skia::Anchor anchor)
+    {
+      const float dir = anchor == anchors::top_left || anchor == anchors::top_right ? 1.f : -1.f;
+      skia::place_text(ctx, label, fonts::regular(16), color, p, anchor);
+      skia::place_text(ctx, value, fonts::black(26), color, {p.x(), p.y() + dir * 20}, anchor);
+    }
+
+    /// A horizontal bar, filled up to `fraction`
+    void draw_bar(skia::Canvas& ctx, skia::Rect rect, float fraction, skia::Color color)
+    {
+      constexpr float r = 5.f;
+      const SkRRect outline = SkRRect::MakeRectXY(rect, r, r);
+      const SkRect filled = SkRect::MakeXYWH(rect.x(), rect.y(), rect.width() * fraction, rect.height());
+      ctx.drawRRect(SkRRect::MakeRectXY(filled, r, r), paints::fill(color));
+      ctx.drawRRect(outline, paints::stroke(color, 3.f));
+    }
+  } // namespace
+
+  struct MainHandler final : InputReducer<State>, IInputLayer {
+    using InputReducer::InputReducer;
+
+    [[nodiscard]] util::enum_bitset<Key> key_mask() const noexcept override
+    {
+      return key_groups::enc_clicks;
+    }
+
+    void reduce(EncoderEvent e, State& state) noexcept final
+    {
+      switch (e.encoder) {
+        case Encoder::blue: state.position += e.steps * 0.01; break;
+        case Encoder::green: state.octave += octave_divider(e); break;
+        case Encoder::yellow: state.detune += e.steps * 0.01; break;
+        case Encoder::red: state.level += e.steps * 0.01; break;
+      }
+    }
+
+  private:
+    util::EventDivider<4> octave_divider;
+  };
+
+  struct MainScreen final : itc::Consumer<State>, ScreenBase {
+    using Consumer::Consumer;
+
+    void draw(skia::Canvas& ctx) noexcept override
+    {
+      const auto& s = state();
+      draw_param(ctx, "OCTAVE", fmt::format("{:+}", static_cast<int>(s.octave)), colors::green, {x_pad, y_pad},
+                 anchors::top_left);
+      draw_param(ctx, "LEVEL", fmt::format("{:.0f}", s.level * 100), colors::red, {320 - x_pad, y_pad},
+                 anchors::top_right);
+      draw_param(ctx, "POSITION", fmt::format("{:.0f}", s.position * 100), colors::blue, {x_pad, 240 - y_pad},
+                 anchors::bottom_left);
+      draw_param(ctx, "DETUNE", fmt::format("{:+.2f}", static_cast<float>(s.detune)), colors::yellow,
+                 {320 - x_pad, 240 - y_pad}, anchors::bottom_right);
+      draw_bar(ctx, SkRect::MakeXYWH(40, 110, 240, 20), s.position, colors::blue);
+    }
+  };
+
+  struct ModHandler final : InputReducer<State>, IInputLayer {
+    using InputReducer::InputReducer;
+
+    [[nodiscard]] util::enum_bitset<Key> key_mask() const noexcept override
+    {
+      return key_groups::enc_clicks;
+    }
+
+    void reduce(EncoderEvent e, State& state) noexcept final
+    {
+      switch (e.encoder) {
+        case Encoder::blue: state.envelope.attack += e.steps * 0.01; break;
+        case Encoder::green: state.envelope.decay += e.steps * 0.01; break;
+        case Encoder::yellow: state.envelope.sustain += e.steps * 0.01; break;
+        case Encoder::red: state.envelope.release += e.steps * 0.01; break;
+      }
+    }
+  };
+
+  struct ModScreen final : itc::Consumer<State>, ScreenBase {
+    using Consumer::Consumer;
+
+    void draw(skia::Canvas& ctx) noexcept override
+    {
+      const auto& env = state().envelope;
+      const std::array<std::pair<const char*, float>, 4> stages = {{
+        {"ATTACK", env.attack},
+        {"DECAY", env.decay},
+        {"SUSTAIN", env.sustain},
+        {"RELEASE", env.release},
+      }};
+      const std::array<skia::Color, 4> stage_colors = {colors::blue, colors::green, colors::yellow, colors::red};
+      for (std::size_t i = 0; i < stages.size(); i++) {
+        const float y = 30 + 50 * float(i);
+        skia::place_text(ctx, stages[i].first, fonts::regular(16), stage_colors[i], {x_pad, y}, anchors::middle_left);
+        draw_bar(ctx, SkRect::MakeXYWH(110, y - 10, 200, 20), stages[i].second, stage_colors[i]);
+      }
+    }
+  };
+
+  ScreenWithHandler make_main_screen(itc::Channel& chan)
+  {
+    return {
+      .screen = std::make_unique<MainScreen>(chan),
+      .input = std::make_unique<MainHandler>(chan),
+    };
+  }
+
+  ScreenWithHandler make_mod_screen(itc::Channel& chan)
+  {
+    return {
+      .screen = std::make_unique<ModScreen>(chan),
+      .input = std::make_unique<ModHandler>(chan),
+    };
+  }
+
+} // namespace otto::engines::wavetable
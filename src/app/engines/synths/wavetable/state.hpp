@@ -0,0 +1,38 @@
+#pragma once
+
+#include <type_traits>
+
+#include "lib/util/visitor.hpp"
+#include "lib/util/with_limits.hpp"
+
+namespace otto::engines::wavetable {
+
+  struct EnvelopeState {
+    util::StaticallyBounded<float, 0, 1> attack = 0.1;
+    util::StaticallyBounded<float, 0, 1> decay = 0.3;
+    util::StaticallyBounded<float, 0, 1> sustain = 0.7;
+    util::StaticallyBounded<float, 0, 1> release = 0.3;
+
+    DECL_VISIT(attack, decay, sustain, release);
+  };
+
+  struct State {
+    /// The position in the list of tables. Between two tables, they are crossfaded.
+    util::StaticallyBounded<float, 0, 1> position = 0;
+    util::StaticallyBounded<int, -2, 2> octave = 0;
+    /// In semitones
+    util::StaticallyBounded<float, -1, 1> detune = 0;
+    util::StaticallyBounded<float, 0, 1> level = 0.8;
+    EnvelopeState envelope;
+
+    DECL_VISIT(position, octave, detune, level, envelope);
+  };
+  static_assert(std::is_trivially_copyable_v<State>);
+
+  /// Duration of an envelope stage in seconds from underlying state member
+  inline float envelope_stage_duration(const float d)
+  {
+    return 5 * d * d + 0.001f;
+  }
+
+} // namespace otto::engines::wavetable
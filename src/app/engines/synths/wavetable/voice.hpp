@@ -0,0 +1,158 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <span>
+
+#include <Gamma/Domain.h>
+#include <Gamma/Envelope.h>
+
+#include "lib/util/audio_buffer.hpp"
+
+#include "lib/dsp/control_rate.hpp"
+#include "lib/dsp/simd.hpp"
+#include "lib/dsp/wavetable.hpp"
+#include "lib/voices/voice_manager.hpp"
+
+#include "state.hpp"
+
+namespace otto::engines::wavetable {
+
+  struct Voice : voices::VoiceBase<Voice> {
+    Voice(const State& state) noexcept : state_(state)
+    {
+      env_.domain(dsp::ControlDomain::master());
+      env_.finish();
+      env_ctl_.jump(0);
+    }
+
+    /// Released, and the envelope is done
+    [[nodiscard]] bool is_idle() const noexcept
+    {
+      return !is_triggered() && env_.done() && !env_ctl_.is_ramping();
+    }
+
+    void on_note_on() noexcept
+    {
+      env_.resetSoft();
+    }
+
+    void on_note_off() noexcept
+    {
+      env_.release();
+    }
+
+    void on_state_change(const State& s) noexcept
+    {
+      env_.attack(envelope_stage_duration(s.envelope.attack));
+      env_.decay(envelope_stage_duration(s.envelope.decay));
+      env_.release(envelope_stage_duration(s.envelope.release));
+      env_.sustain(s.envelope.sustain);
+    }
+
+    /// The next envelope value. The envelope is stepped at control rate, and interpolated in between.
+    float envelope() noexcept
+    {
+      return env_ctl_([this] { return env_(); });
+    }
+
+    const State& state_;
+
+  private:
+    gam::ADSR<> env_;
+    dsp::ControlRateValue<float> env_ctl_;
+  };
+
+  /// Renders `N` voices, each in a lane of {@ref dsp::WavetableLanes}.
+  ///
+  /// The voices keep the envelopes, glide and voice allocation, while the bank keeps the oscillators.
+  /// The tables, the pitch and the mip levels are set once per block, unless a voice is gliding.
+  template<std::size_t N>
+  struct WavetableVoiceBank {
+    static_assert(N <= dsp::simd::lanes, "WavetableVoiceBank has one lane per voice");
+
+    using float_x8 = dsp::simd::float_x8;
+
+    /// Render a block from `voices` into both channels of `output`.
+    ///
+    /// Renders silence while `tables` is empty. Pass the same voices in the same order
+    /// every block, since the phases are kept in the bank.
+    void process(std::span<Voice, N> voices, std::span<const dsp::Wavetable> tables,
+                 util::stereo_audio_buffer& output, util::MixMode mode) noexcept
+    {
+      if (mode == util::MixMode::replace) {
+        const bool rendered = render(voices, tables, output.size(), [&](std::size_t i, float s) {
+          output.left[i] = s;
+          output.right[i] = s;
+        });
+        if (!rendered) output.clear();
+      } else {
+        render(voices, tables, output.size(), [&](std::size_t i, float s) {
+          output.left[i] += s;
+          output.right[i] += s;
+        });
+      }
+    }
+
+  private:
+    /// Calls `write(i, sample)` for each of the `nframes` frames.
+    ///
+    /// @return false if there are no tables or all voices are idle, and nothing was written
+    template<typename Write>
+    bool render(std::span<Voice, N> voices, std::span<const dsp::Wavetable> tables, std::size_t nframes,
+                Write&& write) noexcept
+    {
+      if (tables.empty() || std::ranges::all_of(voices, [](const Voice& v) { return v.is_idle(); })) return false;
+
+      const State& state = voices[0].state_;
+      const float position = state.position * float(tables.size() - 1);
+      from_ = &tables[std::min(static_cast<std::size_t>(position), tables.size() - 1)];
+      to_ = &tables[std::min(static_cast<std::size_t>(position) + 1, tables.size() - 1)];
+      morph_ = position - std::floor(position);
+      pitch_ratio_ = std::exp2(float(state.octave) + state.detune / 12.f);
+
+      float_x8 volume = {};
+      float_x8 amplitude = {};
+      std::array<bool, N> active = {};
+      for (std::size_t v = 0; v < N; v++) {
+        active[v] = !voices[v].is_idle();
+        if (!active[v]) {
+          lanes_.clear(v);
+          continue;
+        }
+        if (!voices[v].is_gliding()) {
+          voices[v].calc_next();
+          set_lane(voices[v], v);
+        }
+        volume[v] = voices[v].volume() * state.level;
+      }
+      for (std::size_t i = 0; i < nframes; i++) {
+        for (std::size_t v = 0; v < N; v++) {
+          if (!active[v]) continue;
+          // Gliding voices get new frequencies every sample
+          if (voices[v].is_gliding()) {
+            voices[v].calc_next();
+            set_lane(voices[v], v);
+          }
+          amplitude[v] = voices[v].envelope();
+        }
+        write(i, dsp::simd::horizontal_sum(lanes_() * amplitude * volume));
+      }
+      return true;
+    }
+
+    void set_lane(const Voice& voice, std::size_t v) noexcept
+    {
+      const float cycles_per_sample = voice.frequency() * pitch_ratio_ / float(gam::sampleRate());
+      lanes_.set(v, *from_, *to_, morph_, cycles_per_sample);
+    }
+
+    dsp::WavetableLanes lanes_;
+    // Set once per block
+    const dsp::Wavetable* from_ = nullptr;
+    const dsp::Wavetable* to_ = nullptr;
+    float morph_ = 0;
+    float pitch_ratio_ = 1;
+  };
+
+} // namespace otto::engines::wavetable
@@ -0,0 +1,16 @@
+#include "wavetable.hpp"
+
+#include "lib/itc/itc.hpp"
+
+namespace otto::engines::wavetable {
+
+  struct Logic final : ILogic, itc::Producer<State> {
+    using Producer::Producer;
+  };
+
+  std::unique_ptr<ILogic> make_logic(itc::Channel& c)
+  {
+    return std::make_unique<Logic>(c);
+  }
+
+} // namespace otto::engines::wavetable
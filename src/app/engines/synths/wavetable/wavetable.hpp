@@ -0,0 +1,31 @@
+#pragma once
+
+#include <filesystem>
+
+#include "lib/engine.hpp"
+#include "lib/graphics.hpp"
+
+#include "app/engines/synths/synth.hpp"
+
+#include "state.hpp"
+
+namespace otto::engines::wavetable {
+
+  /// The directory the wavetables are loaded from, in file name order
+  inline const std::filesystem::path default_wavetable_dir = "data/wavetables";
+
+  std::unique_ptr<ILogic> make_logic(itc::Channel&);
+  ScreenWithHandler make_main_screen(itc::Channel&);
+  ScreenWithHandler make_mod_screen(itc::Channel&);
+  /// The wavetables are loaded from `default_wavetable_dir` on a background thread
+  std::unique_ptr<ISynthAudio> make_audio(itc::Channel&);
+
+  // NOLINTNEXTLINE
+  inline const SynthEngineFactory factory = {
+    .make_logic = make_logic,
+    .make_audio = make_audio,
+    .make_mod_screen = make_mod_screen,
+    .make_main_screen = make_main_screen,
+  };
+
+} // namespace otto::engines::wavetable
@@ -0,0 +1,131 @@
+#include "offline_render.hpp"
+
+#include <fstream>
+
+#include <AudioFile.h>
+#include <lyra.hpp>
+
+#include "lib/logging.hpp"
+#include "lib/midi_script.hpp"
+#include "lib/voices/voice_manager.hpp"
+
+#include "app/drivers/offline_audio_driver.hpp"
+#include "app/engines/midi-fx/arp/arp.hpp"
+#include "app/engines/synths/ottofm/ottofm.hpp"
+#include "app/engines/synths/wavetable/wavetable.hpp"
+#include "app/services/audio.hpp"
+#include "app/services/logic_thread.hpp"
+#include "app/services/state.hpp"
+
+namespace otto {
+  using namespace services;
+
+  // NOLINTNEXTLINE
+  int offline_render_main(int argc, char* argv[])
+  {
+    bool show_help = false;
+    std::string script_path;
+    std::string output_path = "out.wav";
+    std::string state_path;
+    std::string engine_name = "ottofm";
+    std::size_t buffer_size = 256;
+    std::size_t sample_rate = 44100;
+    double tail = 1.0;
+
+    auto cli = lyra::cli_parser() | lyra::help(show_help) //
+               | lyra::arg(script_path, "script")("Midi script to render").required()
+               | lyra::opt(output_path, "file")["-o"]["--output"]("Output wav file")
+               | lyra::opt(state_path, "file")["-s"]["--state"]("State file to load the engine settings from")
+               | lyra::opt(engine_name, "name")["-e"]["--engine"]("Synth engine to render with")
+                   .choices("ottofm", "wavetable")
+               | lyra::opt(buffer_size, "frames")["-b"]["--buffer-size"]("Frames per audio callback")
+               | lyra::opt(sample_rate, "hz")["-r"]["--sample-rate"]("Sample rate")
+               | lyra::opt(tail, "seconds")["-t"]["--tail"]("Time to render after the end of the script");
+    auto result = cli.parse({argc, argv});
+    if (!result) {
+      LOGE("{}", result.errorMessage());
+      std::cerr << cli << std::endl;
+      return 1;
+    }
+    if (show_help) {
+      std::cout << cli << std::endl;
+      return 0;
+    }
+
+    std::ifstream script_file(script_path);
+    if (!script_file) {
+      LOGE("Could not open {}", script_path);
+      return 1;
+    }
+    midi::MidiScript script;
+    try {
+      script = midi::MidiScript::parse(script_file);
+    } catch (util::exception& e) {
+      LOGE("{}: {}", script_path, e.what());
+      return 1;
+    }
+
+    // Services
+    LogicThread logic_thread;
+    auto driver_ptr = std::make_unique<drivers::OfflineAudioDriver>(buffer_size, sample_rate);
+    auto& driver = *driver_ptr;
+    Audio audio(std::move(driver_ptr));
+
+    // Engines, as in the application
+    itc::Context ctx;
+    const auto& factory = engine_name == "wavetable" ? engines::wavetable::factory : engines::ottofm::factory;
+    auto eng = factory.make_without_screens(ctx["synth"]);
+    auto voices_logic = voices::make_voices_logic(ctx["synth"]);
+    auto midifx_eng = engines::arp::factory.make_without_screen(ctx["midifx"]);
+    midifx_eng.audio->set_target(&eng.audio->midi_handler());
+
+    if (!state_path.empty()) {
+      StateManager stateman(state_path);
+      stateman.add("Context", std::ref(ctx));
+      stateman.read_from_file();
+    }
+
+    auto stop_midi = audio.set_midi_handler(&*midifx_eng.audio);
+    auto stop_audio = audio.set_process_callback([&](Audio::CallbackData data) {
+      const auto arp_events = midifx_eng.audio->process(data.output.size());
+      eng.audio->process_timed(data.output, util::MixMode::replace, arp_events);
+    });
+    // Let the loaded state reach the audio engines
+    logic_thread.sync();
+    audio.sync();
+    eng.audio->wait_until_ready();
+
+    // Events are scheduled one buffer late, as with a sound card, so render one extra buffer
+    const auto frame_of = [&](double time) { return static_cast<std::size_t>(time * double(sample_rate)); };
+    const std::size_t nframes = frame_of(script.end_time + tail) + buffer_size;
+    AudioFile<float> wav;
+    wav.setSampleRate(static_cast<std::uint32_t>(sample_rate));
+    wav.setAudioBufferSize(2, 0);
+    for (auto& chan : wav.samples) chan.reserve(nframes);
+
+    auto next_event = script.events.begin();
+    const auto start = std::chrono::steady_clock::now();
+    driver.render(
+      nframes,
+      [&](std::size_t frame) {
+        for (; next_event != script.events.end() && frame_of(next_event->time) < frame; ++next_event) {
+          audio.midi().send_event(next_event->event, driver.time_of(frame_of(next_event->time)));
+        }
+      },
+      [&](const util::stereo_audio_buffer& output) {
+        wav.samples[0].insert(wav.samples[0].end(), output.left.begin(), output.left.end());
+        wav.samples[1].insert(wav.samples[1].end(), output.right.begin(), output.right.end());
+      });
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    const double rendered = double(nframes) / double(sample_rate);
+    LOGI("Rendered {:.2f}s in {:.3f}s: {:.1f}x realtime, {:.0f} samples/s", rendered, elapsed.count(),
+         rendered / elapsed.count(), double(nframes) / elapsed.count());
+    if (!wav.save(output_path)) {
+      LOGE("Could not write {}", output_path);
+      return 1;
+    }
+    return 0;
+  }
+
+} // namespace otto
@@ -0,0 +1,8 @@
+#pragma once
+
+namespace otto {
+  /// Render a midi script through the synth to a wav file, without a sound card.
+  ///
+  /// See `midi::MidiScript` for the script format, and run with `--help` for the options.
+  int offline_render_main(int argc, char* argv[]);
+} // namespace otto
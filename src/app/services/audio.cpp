@@ -7,41 +7,89 @@ namespace otto::services {
   Audio::Audio(util::smart_ptr<drivers::IAudioDriver>&& d) : driver_(std::move(d))
   {
     driver_->set_callback(std::bind_front(&Audio::loop_func, this));
-    AudioDomain::buffer_pool_ = util::AudioBufferPool{16, driver_->buffer_size()};
     gam::sampleRate(util::narrow<double>(driver_->sample_rate()));
     driver_->start();
   }
 
+  void Audio::compile_graph(AudioGraph& graph)
+  {
+    auto& pool = AudioDomain::buffer_pool_;
+    const std::size_t slots = graph.plan_buffers().slot_count;
+    if (!pool || pool->capacity() < slots) {
+      OTTO_ASSERT(!pool || pool->in_use() == 0, "The audio buffer pool can not be replaced while it is in use");
+      pool.emplace(slots, driver_->buffer_size());
+    }
+    graph.compile(*pool);
+  }
+
   util::at_exit Audio::set_midi_handler(util::smart_ptr<midi::IMidiHandler> h) noexcept
   {
-    executor().execute([this, h = std::move(h)]() mutable { midi_.set_handler(std::move(h)); });
-    executor().sync();
-    return util::at_exit([this] {
+    return set_midi_handler_async(std::move(h)).sync_wait();
+  }
+
+  itc::Task<util::at_exit> Audio::set_midi_handler_async(util::smart_ptr<midi::IMidiHandler> h)
+  {
+    // Constructed before switching threads, so the audio thread does not allocate
+    util::at_exit stop([this] {
       executor().execute([this] { midi_.set_handler(nullptr); });
       executor().sync();
     });
+    co_await executor();
+    midi_.set_handler(std::move(h));
+    co_return std::move(stop);
   }
 
   util::at_exit Audio::set_process_callback(Callback&& cb) noexcept
   {
-    executor().execute([this, cb = std::move(cb)]() mutable { callback_ = std::move(cb); });
-    executor().sync();
-    return util::at_exit([this] {
+    return set_process_callback_async(std::move(cb)).sync_wait();
+  }
+
+  itc::Task<util::at_exit> Audio::set_process_callback_async(Callback cb)
+  {
+    util::at_exit stop([this] {
       executor().execute([this] { callback_ = nullptr; });
       executor().sync();
     });
+    co_await executor();
+    callback_ = std::move(cb);
+    co_return std::move(stop);
   }
 
   void Audio::loop_func(CallbackData data) noexcept
   {
-    midi_.process_events();
-    if (callback_) {
-      callback_(data);
-    } else {
-      data.output.clear();
+    const auto start = std::chrono::steady_clock::now();
+    const std::size_t nframes = data.output.size();
+    const std::size_t sample_rate = driver_->sample_rate();
+    const auto period = chrono::duration_cast<chrono::duration>(
+      std::chrono::duration<double>(static_cast<double>(nframes) / static_cast<double>(sample_rate)));
+    const auto events = midi_.collect_events(driver_->now() - period, nframes, sample_rate);
+
+    // Render in blocks between the midi events
+    std::size_t frame = 0;
+    const auto render_until = [&](std::size_t end) {
+      if (end == frame) return;
+      const auto input = data.input.slice(frame, end - frame);
+      auto output = data.output.slice(frame, end - frame);
+      if (callback_) {
+        callback_({.input = input, .output = output});
+      } else {
+        output.clear();
+      }
+      frame = end;
+    };
+    for (const auto& evt : events) {
+      render_until(evt.frame);
+      midi_.dispatch(evt.event);
     }
-    executor().run_queued_functions();
+    render_until(nframes);
+
+    executor().run_queued_functions(chrono::duration_cast<chrono::duration>(period * executor_budget),
+                                    executor_max_functions);
     buffer_count_++;
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    const double period_secs = static_cast<double>(nframes) / static_cast<double>(sample_rate);
+    timing_.record(static_cast<float>(elapsed.count() / period_secs), data.xrun);
   }
 
   unsigned Audio::buffer_count() noexcept
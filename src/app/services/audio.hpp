@@ -2,6 +2,8 @@
 
 #include <tl/optional.hpp>
 
+#include "lib/audio_graph.hpp"
+#include "lib/audio_timing.hpp"
 #include "lib/util/at_exit.hpp"
 #include "lib/util/audio_buffer.hpp"
 #include "lib/util/smart_ptr.hpp"
@@ -9,6 +11,7 @@
 #include "lib/itc/executor.hpp"
 #include "lib/itc/executor_provider.hpp"
 #include "lib/itc/itc.hpp"
+#include "lib/itc/task.hpp"
 #include "lib/midi.hpp"
 
 #include "app/domains/audio.hpp"
@@ -22,14 +25,54 @@ namespace otto::services {
     using CallbackData = drivers::IAudioDriver::CallbackData;
     using Callback = drivers::IAudioDriver::Callback;
 
+    /// The fraction of the buffer period the audio thread spends on its executor each callback.
+    /// Functions that do not fit are run in the next callback.
+    static constexpr float executor_budget = 0.25f;
+    /// The maximum number of executor functions run each callback
+    static constexpr std::size_t executor_max_functions = 64;
+
     Audio(util::smart_ptr<drivers::IAudioDriver>&& d = drivers::IAudioDriver::make_default());
 
+    /// Set the function that renders audio.
+    ///
+    /// The driver buffer is split at the frame offsets of incoming midi events, and the
+    /// callback is called once for each block in between, after the events at its start
+    /// have been dispatched. Use `data.output.size()` as the length of the block.
     util::at_exit set_process_callback(Callback&& cb) noexcept;
     util::at_exit set_midi_handler(util::smart_ptr<midi::IMidiHandler> h) noexcept;
+
+    /// Like `set_process_callback`, without blocking the calling thread.
+    ///
+    /// The task finishes on the audio thread. Await another executor to continue elsewhere.
+    itc::Task<util::at_exit> set_process_callback_async(Callback cb);
+    /// Like `set_midi_handler`, without blocking the calling thread.
+    ///
+    /// The task finishes on the audio thread. Await another executor to continue elsewhere.
+    itc::Task<util::at_exit> set_midi_handler_async(util::smart_ptr<midi::IMidiHandler> h);
+    /// Compile `graph` for the driver buffer size, with its output buffers in `AudioDomain::buffer_pool()`.
+    ///
+    /// The pool is sized from the buffer plan of the graph, so it has exactly one buffer per slot.
+    /// Call before the graph is processed. The pool is only replaced while none of its buffers are in use.
+    void compile_graph(AudioGraph& graph);
+
     drivers::MidiController& midi() noexcept;
     unsigned buffer_count() noexcept;
     void wait_for_n_buffers(int n) noexcept;
 
+    /// Timing statistics of the audio callback, and the xruns reported by the driver.
+    ///
+    /// The load is the time spent in the callback as a fraction of the buffer period.
+    [[nodiscard]] AudioTimingStats::Snapshot timing_stats() const noexcept
+    {
+      return timing_.snapshot();
+    }
+
+    /// Clear the timing statistics, starting from the next callback
+    void reset_timing_stats() noexcept
+    {
+      timing_.reset();
+    }
+
     drivers::IAudioDriver& driver() noexcept
     {
       return *driver_;
@@ -42,5 +85,6 @@ namespace otto::services {
     Callback callback_ = nullptr;
     drivers::MidiDriver midi_;
     std::atomic<unsigned> buffer_count_ = 0;
+    AudioTimingStats timing_;
   };
 } // namespace otto::services
@@ -1,29 +1,11 @@
 #include "controller.hpp"
 
+#include "lib/itc/transaction.hpp"
+
 namespace otto::services {
 
   using namespace drivers;
 
-  struct ExecutorWrapper : InputHandler, LogicDomain {
-    ExecutorWrapper(util::smart_ptr<IInputHandler>&& delegate) : delegate_(std::move(delegate)) {}
-
-    void handle(KeyPress e) noexcept override
-    {
-      executor().execute([h = delegate_.get(), e] { h->handle(e); });
-    }
-    void handle(KeyRelease e) noexcept override
-    {
-      executor().execute([h = delegate_.get(), e] { h->handle(e); });
-    }
-    void handle(EncoderEvent e) noexcept override
-    {
-      executor().execute([h = delegate_.get(), e] { h->handle(e); });
-    }
-
-  private:
-    util::smart_ptr<IInputHandler> delegate_;
-  };
-
   Controller::Controller(RuntimeController& rt, ConfigManager& confman, util::smart_ptr<drivers::MCUPort>&& port)
     : conf_(confman), com_(rt, std::move(port)), thread_([this](const std::stop_token& stop_token) {
         while (!stop_token.stop_requested()) {
@@ -31,11 +13,14 @@ namespace otto::services {
           while (queue_.try_dequeue(data)) {
             com_.port_->write(data);
           }
-          Packet p;
-          do {
-            p = com_.port_->read();
-            com_.handle_packet(p);
-          } while (p.cmd != Command::none);
+          for (Packet p = com_.port_->read(); p.cmd != Command::none; p = com_.port_->read()) {
+            // The events of a packet are handled in one transaction, so the state
+            // changes they cause reach the consumers as one update
+            executor().execute([this, p] {
+              itc::Transaction t;
+              com_.handle_packet(p);
+            });
+          }
           std::this_thread::sleep_for(conf_.wait_time);
         }
       })
@@ -43,12 +28,18 @@ namespace otto::services {
 
   util::at_exit Controller::set_input_handler(IInputHandler& h)
   {
-    executor().execute([this, &h] { com_.handler = std::make_unique<ExecutorWrapper>(&h); });
-    executor().sync();
-    return util::at_exit([this] {
+    return set_input_handler_async(h).sync_wait();
+  }
+
+  itc::Task<util::at_exit> Controller::set_input_handler_async(IInputHandler& h)
+  {
+    util::at_exit stop([this] {
       executor().execute([this] { com_.handler = nullptr; });
       executor().sync();
     });
+    co_await executor();
+    com_.handler = &h;
+    co_return std::move(stop);
   }
 
   MCUCommunicator::MCUCommunicator(RuntimeController& rt, util::smart_ptr<MCUPort>&& port)
@@ -3,6 +3,8 @@
 #include "lib/util/at_exit.hpp"
 #include "lib/util/smart_ptr.hpp"
 
+#include "lib/itc/task.hpp"
+
 #include "app/drivers/mcu_port.hpp"
 #include "app/input.hpp"
 #include "app/leds.hpp"
@@ -19,6 +21,8 @@ namespace otto::services {
 
     /// Handle received packet, and send events.
     ///
+    /// The `Controller` calls this on the logic thread, in an `itc::Transaction`.
+    ///
     /// @throws util::exception if the data is invalid.
     void handle_packet(drivers::Packet p);
 
@@ -50,6 +54,10 @@ namespace otto::services {
     }
 
     util::at_exit set_input_handler(IInputHandler& h);
+    /// Like `set_input_handler`, without blocking the calling thread.
+    ///
+    /// The task finishes on the logic thread.
+    itc::Task<util::at_exit> set_input_handler_async(IInputHandler& h);
 
     auto port_writer() noexcept
     {
@@ -19,12 +19,18 @@ namespace otto::services {
 
   util::at_exit Graphics::show(DrawFunc f)
   {
-    executor().execute([this, f = std::move(f)]() mutable { draw_func_ = std::move(f); });
-    executor().sync();
-    return util::at_exit([this] {
+    return show_async(std::move(f)).sync_wait();
+  }
+
+  itc::Task<util::at_exit> Graphics::show_async(DrawFunc f)
+  {
+    util::at_exit stop([this] {
       executor().execute([this] { draw_func_ = nullptr; });
       executor().sync();
     });
+    co_await executor();
+    draw_func_ = std::move(f);
+    co_return std::move(stop);
   }
 
   void Graphics::loop_function(SkCanvas& ctx)
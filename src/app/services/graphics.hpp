@@ -8,6 +8,7 @@
 #include "lib/itc/executor.hpp"
 #include "lib/itc/executor_provider.hpp"
 #include "lib/itc/itc.hpp"
+#include "lib/itc/task.hpp"
 
 #include "app/domains/graphics.hpp"
 #include "app/drivers/graphics_driver.hpp"
@@ -21,6 +22,10 @@ namespace otto::services {
     Graphics(RuntimeController& runtime, util::smart_ptr<IGraphicsDriver>&& driver = IGraphicsDriver::make_default());
     /// Open a window/display drawing the given draw function
     util::at_exit show(DrawFunc f);
+    /// Like `show`, without blocking the calling thread.
+    ///
+    /// The task finishes on the graphics thread.
+    itc::Task<util::at_exit> show_async(DrawFunc f);
 
   private:
     /// The function to run in the main loop on the graphics thread.
@@ -4,8 +4,10 @@ namespace otto::services {
 
   LogicThread::LogicThread()
     : thread_([this](const std::stop_token& token) {
+        // Sleep until there is something to do, instead of waking up to check for the stop request
+        std::stop_callback wake(token, [this] { executor().notify(); });
         while (!token.stop_requested()) {
-          executor().run_queued_functions_blocking(std::chrono::milliseconds(100));
+          executor().run_queued_functions_blocking();
         }
         // TODO: propper shutdown!
       })
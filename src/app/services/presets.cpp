@@ -0,0 +1,131 @@
+#include "presets.hpp"
+
+#include <algorithm>
+#include <tuple>
+
+#include "lib/util/exception.hpp"
+
+#include "lib/logging.hpp"
+
+namespace otto::services {
+
+  namespace {
+    bool is_preset_file(const std::filesystem::path& p)
+    {
+      const auto ext = p.extension();
+      return ext == ".json" || ext == ".cbor" || ext == ".msgpack";
+    }
+  } // namespace
+
+  PresetLibrary::PresetLibrary(std::filesystem::path root, std::size_t cache_size)
+    : root_(std::move(root)),
+      cache_size_(cache_size),
+      thread_([this](const std::stop_token& token) {
+        build_index(token);
+        std::stop_callback wake(token, [this] { executor_.notify(); });
+        while (!token.stop_requested()) {
+          executor_.run_queued_functions_blocking();
+        }
+      })
+  {
+    cache_.reserve(cache_size_);
+  }
+
+  std::shared_ptr<const PresetLibrary::Index> PresetLibrary::index() const
+  {
+    std::scoped_lock l(index_mutex_);
+    return index_;
+  }
+
+  itc::Task<std::shared_ptr<const PresetLibrary::Index>> PresetLibrary::wait_for_index()
+  {
+    // The I/O thread only runs functions once the index is built
+    co_await executor_;
+    co_return index();
+  }
+
+  itc::Task<PresetLibrary::Body> PresetLibrary::load(std::size_t i)
+  {
+    co_await itc::resume_on(executor_, itc::Priority::high);
+    co_return get_or_load(i);
+  }
+
+  void PresetLibrary::prefetch(std::size_t i, std::size_t radius)
+  {
+    const auto generation = ++prefetch_generation_;
+    executor_.execute([this, i, radius, generation] {
+      const auto prefetch_one = [&](std::size_t j) {
+        // Unsigned, so indices before the first preset wrap around to after the last
+        if (j >= index_->size() || prefetch_generation_ != generation) return;
+        try {
+          get_or_load(j);
+        } catch (util::exception& e) {
+          LOGW("{}", e.what());
+        }
+      };
+      prefetch_one(i);
+      for (std::size_t d = 1; d <= radius; d++) {
+        prefetch_one(i + d);
+        prefetch_one(i - d);
+      }
+    });
+  }
+
+  std::span<const PresetInfo> PresetLibrary::presets_of(const Index& index, std::string_view engine) noexcept
+  {
+    const auto [first, last] = std::ranges::equal_range(index, engine, std::ranges::less{}, &PresetInfo::engine);
+    return {first, last};
+  }
+
+  void PresetLibrary::build_index(const std::stop_token& stop)
+  {
+    auto index = std::make_shared<Index>();
+    std::error_code ec;
+    for (std::filesystem::recursive_directory_iterator it(root_, ec), end; it != end && !ec; it.increment(ec)) {
+      if (stop.stop_requested()) return;
+      const auto& path = it->path();
+      if (!it->is_regular_file() || !is_preset_file(path)) continue;
+      try {
+        // The bodies are not kept, the index only holds what is needed to browse them
+        const auto preset = json::parse_file(path);
+        index->push_back({
+          .name = preset.value("name", path.stem().string()),
+          .engine = preset.value("engine", path.parent_path().filename().string()),
+          .tags = preset.value("tags", std::vector<std::string>()),
+          .path = path,
+        });
+      } catch (std::exception& e) {
+        LOGW("Skipping preset {}: {}", path, e.what());
+      }
+    }
+    if (ec) LOGW("Could not read all presets in {}: {}", root_, ec.message());
+    std::ranges::sort(*index, {}, [](const PresetInfo& p) { return std::tie(p.engine, p.name); });
+    LOGI("Found {} presets in {}", index->size(), root_);
+    std::scoped_lock l(index_mutex_);
+    index_ = std::move(index);
+  }
+
+  PresetLibrary::Body PresetLibrary::get_or_load(std::size_t i)
+  {
+    const auto found = std::ranges::find(cache_, i, &std::pair<std::size_t, Body>::first);
+    if (found != cache_.end()) {
+      // Move it to the most recently used end
+      std::rotate(found, found + 1, cache_.end());
+      return cache_.back().second;
+    }
+    // The index is only replaced on this thread, so it can be read without the lock
+    const auto& index = *index_;
+    if (i >= index.size()) throw util::exception("No preset {}, there are {}", i, index.size());
+    Body body;
+    try {
+      body = std::make_shared<const json::value>(json::parse_file(index[i].path));
+    } catch (std::exception& e) {
+      throw util::exception("Could not load preset {}: {}", index[i].path.string(), e.what());
+    }
+    if (cache_size_ == 0) return body;
+    if (cache_.size() >= cache_size_) cache_.erase(cache_.begin());
+    cache_.emplace_back(i, body);
+    return body;
+  }
+
+} // namespace otto::services
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "lib/itc/executor.hpp"
+#include "lib/itc/task.hpp"
+#include "lib/json.hpp"
+
+namespace otto::services {
+
+  /// The summary of a preset file, as kept in the index of a {@ref PresetLibrary}
+  struct PresetInfo {
+    std::string name;
+    /// The name of the engine the preset is for
+    std::string engine;
+    std::vector<std::string> tags;
+    std::filesystem::path path;
+  };
+
+  /// The presets in a directory, like `data/presets`.
+  ///
+  /// Presets are files in a directory per engine, in any format {@ref json::parse_file} reads,
+  /// with optional `name`, `engine` and `tags` fields. The library has its own I/O thread, which
+  /// builds an index of the presets when the library is constructed, and loads the preset bodies
+  /// when they are needed. Nothing here blocks the calling thread, so the user can scroll through
+  /// hundreds of presets without stalling the UI or the logic thread:
+  /// ```cpp
+  /// itc::Task<> select_preset(std::size_t i)
+  /// {
+  ///   presets.prefetch(i);
+  ///   auto body = co_await presets.load(i);
+  ///   co_await logic.executor();
+  ///   apply(*body);
+  /// }
+  /// ```
+  /// The most recently used bodies are cached. Tasks must be done before the library is destroyed.
+  struct PresetLibrary {
+    using Index = std::vector<PresetInfo>;
+    using Body = std::shared_ptr<const json::value>;
+
+    static constexpr std::size_t default_cache_size = 32;
+    /// The number of presets on each side of the selected one that `prefetch` loads
+    static constexpr std::size_t default_prefetch_radius = 2;
+
+    /// Start the I/O thread, and build the index of the presets in `root`
+    explicit PresetLibrary(std::filesystem::path root, std::size_t cache_size = default_cache_size);
+
+    PresetLibrary(const PresetLibrary&) = delete;
+    PresetLibrary& operator=(const PresetLibrary&) = delete;
+
+    /// The index, sorted by engine, then name. Empty until it is built.
+    [[nodiscard]] std::shared_ptr<const Index> index() const;
+
+    /// Wait for the index to be built. Resumes on the I/O thread.
+    itc::Task<std::shared_ptr<const Index>> wait_for_index();
+
+    /// Load the body of preset `i` of the index, or take it from the cache. Resumes on the I/O thread.
+    ///
+    /// Runs before any prefetching that is queued.
+    ///
+    /// @throws util::exception if there is no such preset, or it can not be read
+    itc::Task<Body> load(std::size_t i);
+
+    /// Load the presets around `i` into the cache, nearest first.
+    ///
+    /// A call cancels the prefetching of the previous one, so scrolling quickly does not queue up work.
+    void prefetch(std::size_t i, std::size_t radius = default_prefetch_radius);
+
+    /// The presets of `engine` in `index`
+    [[nodiscard]] static std::span<const PresetInfo> presets_of(const Index& index, std::string_view engine) noexcept;
+
+  private:
+    void build_index(const std::stop_token& stop);
+    /// Only call on the I/O thread
+    Body get_or_load(std::size_t i);
+
+    std::filesystem::path root_;
+    std::size_t cache_size_;
+
+    mutable std::mutex index_mutex_;
+    /// Replaced once, by the I/O thread
+    std::shared_ptr<const Index> index_ = std::make_shared<const Index>();
+
+    /// Least recently used first. Only accessed by the I/O thread.
+    std::vector<std::pair<std::size_t, Body>> cache_;
+    /// Incremented by each call to `prefetch`, to cancel the previous one
+    std::atomic<std::uint64_t> prefetch_generation_ = 0;
+
+    itc::QueueExecutor executor_;
+    std::jthread thread_;
+  };
+
+} // namespace otto::services
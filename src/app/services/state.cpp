@@ -0,0 +1,111 @@
+#include "state.hpp"
+
+#include "lib/itc/producer.hpp"
+
+namespace otto::services {
+
+  StateManager::~StateManager() noexcept
+  {
+    if (autosave_) {
+      autosave_->stopped = true;
+      // Wait for an autosave that is running right now
+      autosave_->executor.sync();
+    }
+  }
+
+  void StateManager::write_to_file()
+  {
+    if (!journal_) {
+      json::write_to_file(util::serialize(*this), file_path_);
+      return;
+    }
+    if (autosave_) {
+      // The autosave runs on the executor, so collect the last changes there too
+      autosave_->executor.execute([this] { journal_changes(); });
+      autosave_->executor.sync();
+    } else {
+      journal_changes();
+    }
+    journal_->compact();
+    journal_->flush();
+  }
+
+  void StateManager::start_journal()
+  {
+    if (journal_) return;
+    // The current states are in the initial document
+    std::vector<StateJournal::Record> ignored;
+    collect_changes(ignored);
+    journal_ = std::make_unique<StateJournal>(file_path_, util::serialize(*this));
+  }
+
+  void StateManager::start_autosave(itc::IExecutor& executor, chrono::duration interval)
+  {
+    start_journal();
+    if (autosave_) return;
+    autosave_ = std::make_shared<Autosave>(this, executor, interval);
+    schedule_autosave(autosave_);
+  }
+
+  void StateManager::schedule_autosave(std::shared_ptr<Autosave> autosave)
+  {
+    auto& executor = autosave->executor;
+    const auto interval = autosave->interval;
+    executor.execute_after(interval, [autosave = std::move(autosave)]() mutable {
+      if (autosave->stopped) return;
+      autosave->self->journal_changes();
+      schedule_autosave(std::move(autosave));
+    });
+  }
+
+  void StateManager::journal_changes()
+  {
+    if (!journal_) return;
+    std::vector<StateJournal::Record> records;
+    collect_changes(records);
+    journal_->append(std::move(records));
+  }
+
+  void StateManager::collect_changes(std::vector<StateJournal::Record>& records)
+  {
+    std::vector<std::string> path;
+    for (const auto& [key, ctx] : contexts_) {
+      path.assign({key});
+      journal_context(path, *ctx, records);
+    }
+    // Other states have no version to compare, but they are small
+    for (const auto& [key, ser] : serializers_) {
+      if (contexts_.contains(key)) continue;
+      auto value = util::serialize(ser);
+      auto& last = last_values_[key];
+      if (value == last) continue;
+      last = value;
+      records.push_back({{key}, std::move(value)});
+    }
+  }
+
+  void StateManager::journal_context(std::vector<std::string>& path, const itc::Context& ctx,
+                                     std::vector<StateJournal::Record>& records)
+  {
+    for (const auto& entry : ctx.providers()) {
+      const auto* versioned = dynamic_cast<const itc::IVersioned*>(entry.provider);
+      const auto* ser = dynamic_cast<const util::ISerializable*>(entry.provider);
+      if (versioned == nullptr || ser == nullptr) continue;
+      // States that are not saved with the app stay at version 0
+      const auto version = versioned->version();
+      if (version == 0) continue;
+      auto& last = versions_[entry.provider];
+      if (version == last) continue;
+      last = version;
+      path.emplace_back(entry.name.c_str());
+      records.push_back({path, util::serialize(*ser)});
+      path.pop_back();
+    }
+    for (const auto& [name, child] : ctx.children()) {
+      path.push_back(name);
+      journal_context(path, *child, records);
+      path.pop_back();
+    }
+  }
+
+} // namespace otto::services
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <string_view>
 #include <utility>
 
@@ -9,45 +10,94 @@
 #include "lib/util/serialization.hpp"
 #include "lib/util/smart_ptr.hpp"
 
+#include "lib/chrono.hpp"
+#include "lib/itc/context.hpp"
+#include "lib/itc/executor.hpp"
 #include "lib/logging.hpp"
 
+#include "app/services/state_journal.hpp"
+
 namespace otto::services {
 
+  /// Reads and writes the state of the application.
+  ///
+  /// The state file is written in the format of its extension, see {@ref json::format_of}.
+  ///
+  /// With autosave, changes are written to a {@ref StateJournal} as they happen, so they
+  /// survive a crash. Only the states of producers that committed since the last autosave
+  /// are serialized, so autosaving costs the logic thread little, and the other threads nothing.
   struct StateManager {
+    static constexpr chrono::duration default_autosave_interval = std::chrono::seconds(1);
+
     StateManager(std::filesystem::path path) : file_path_(std::move(path)) {}
 
+    /// Stops autosaving. Pending changes are written to the journal, but not compacted.
+    ~StateManager() noexcept;
+
+    StateManager(const StateManager&) = delete;
+    StateManager& operator=(const StateManager&) = delete;
+
     void add(std::string key, util::DynSerializable ser)
     {
       serializers_.try_emplace(std::move(key), std::move(ser));
     }
 
+    /// Add a context. Its producers are journaled one by one, when they commit.
+    void add(std::string key, std::reference_wrapper<itc::Context> ctx)
+    {
+      contexts_.try_emplace(key, &ctx.get());
+      serializers_.try_emplace(std::move(key), ctx);
+    }
+
     bool remove(const std::string& key)
     {
+      contexts_.erase(key);
+      last_values_.erase(key);
       auto found = serializers_.find(key);
       if (found == serializers_.end()) return false;
       serializers_.erase(found);
       return true;
     }
 
-    void write_to_file()
+    /// Write the state file. With autosave, this compacts the journal into it.
+    void write_to_file();
+
+    /// Start journaling changes every `interval`, on `executor`.
+    ///
+    /// Call after `read_from_file`. The executor should run on the thread the states are
+    /// modified on, and must outlive the state manager, which must be destroyed on another thread.
+    void start_autosave(itc::IExecutor& executor, chrono::duration interval = default_autosave_interval);
+
+    /// Start the journal, without scheduling `journal_changes`
+    void start_journal();
+
+    /// Write the states that changed since the last call to the journal
+    ///
+    /// Must be called on the thread the states are modified on.
+    void journal_changes();
+
+    /// Block until the journal has written everything queued so far
+    void flush_journal()
     {
-      json::write_to_file(util::serialize(*this), file_path_);
+      if (journal_) journal_->flush();
     }
 
+    /// Read the state file, including the changes journaled after it was written
     void read_from_file()
     {
-      if (!std::filesystem::exists(file_path_)) {
+      const auto found = json::find_file(file_path_);
+      if (!std::filesystem::exists(found) && !std::filesystem::exists(StateJournal::journal_path(file_path_))) {
         LOGW("State file {} not found", file_path_);
         return;
       }
       try {
-        util::deserialize_from(json::parse_file(file_path_), *this);
+        util::deserialize_from(StateJournal::load(file_path_), *this);
       } catch (json::value::parse_error& e) {
         LOGE("State file parse error!");
         LOGE("{}", e.what());
-        auto corrupt = file_path_;
+        auto corrupt = found;
         corrupt += ".corrupt";
-        std::filesystem::rename(file_path_, corrupt);
+        std::filesystem::rename(found, corrupt);
         LOGE("State file has been backed up as {}", corrupt);
       }
     }
@@ -62,8 +112,30 @@ namespace otto::services {
     }
 
   private:
+    /// Shared with the scheduled autosave functions, so they can outlive the state manager
+    struct Autosave {
+      StateManager* self;
+      itc::IExecutor& executor;
+      chrono::duration interval;
+      std::atomic<bool> stopped = false;
+    };
+
+    static void schedule_autosave(std::shared_ptr<Autosave> autosave);
+    void collect_changes(std::vector<StateJournal::Record>& records);
+    void journal_context(std::vector<std::string>& path, const itc::Context& ctx,
+                         std::vector<StateJournal::Record>& records);
+
     boost::container::flat_map<std::string, util::DynSerializable> serializers_;
     std::filesystem::path file_path_;
+
+    /// Contexts are journaled by provider, everything else by key
+    boost::container::flat_map<std::string, itc::Context*> contexts_;
+    /// The version of each journaled producer
+    boost::container::flat_map<const void*, std::uint64_t> versions_;
+    /// The last journaled value of the keys that are not contexts
+    boost::container::flat_map<std::string, json::value> last_values_;
+    std::unique_ptr<StateJournal> journal_;
+    std::shared_ptr<Autosave> autosave_;
   };
 
 } // namespace otto::services
@@ -0,0 +1,183 @@
+#include "state_journal.hpp"
+
+#include <fstream>
+
+#include <unistd.h>
+
+#include "lib/logging.hpp"
+
+namespace otto::services {
+
+  namespace {
+    json::value& at_path(json::value& document, const std::vector<std::string>& path)
+    {
+      json::value* res = &document;
+      for (const auto& key : path) res = &(*res)[key];
+      return *res;
+    }
+
+    /// Write the buffered data of `f` to the disk
+    bool sync_file(std::FILE* f) noexcept
+    {
+      return std::fflush(f) == 0 && ::fsync(::fileno(f)) == 0;
+    }
+  } // namespace
+
+  StateJournal::StateJournal(std::filesystem::path state_path, json::value document, std::size_t compact_after)
+    : state_path_(std::move(state_path)),
+      journal_path_(journal_path(state_path_)),
+      compact_after_(compact_after),
+      document_(std::move(document)),
+      thread_([this](const std::stop_token& stop) { run(stop); })
+  {}
+
+  StateJournal::~StateJournal() noexcept
+  {
+    thread_.request_stop();
+    thread_.join();
+    if (journal_ != nullptr) std::fclose(journal_);
+  }
+
+  std::filesystem::path StateJournal::journal_path(const std::filesystem::path& state_path)
+  {
+    auto res = state_path;
+    res += ".journal";
+    return res;
+  }
+
+  void StateJournal::append(std::vector<Record>&& records)
+  {
+    if (records.empty()) return;
+    {
+      std::scoped_lock l(mutex_);
+      if (queue_.empty()) {
+        queue_ = std::move(records);
+      } else {
+        std::ranges::move(records, std::back_inserter(queue_));
+      }
+      requested_++;
+    }
+    cv_.notify_all();
+  }
+
+  void StateJournal::compact()
+  {
+    {
+      std::scoped_lock l(mutex_);
+      compact_requested_ = true;
+      requested_++;
+    }
+    cv_.notify_all();
+  }
+
+  void StateJournal::flush()
+  {
+    std::unique_lock l(mutex_);
+    const auto target = requested_;
+    cv_.wait(l, [&] { return written_ >= target; });
+  }
+
+  void StateJournal::run(const std::stop_token& stop)
+  {
+    write_compacted();
+    {
+      std::scoped_lock l(mutex_);
+      written_ = 1;
+    }
+    cv_.notify_all();
+    while (true) {
+      std::vector<Record> records;
+      bool compact = false;
+      std::uint64_t target = 0;
+      {
+        std::unique_lock l(mutex_);
+        // Returns false once stopped, with nothing left to write
+        if (!cv_.wait(l, stop, [&] { return !queue_.empty() || compact_requested_; })) return;
+        records = std::exchange(queue_, {});
+        compact = std::exchange(compact_requested_, false);
+        target = requested_;
+      }
+      write_records(records);
+      if (compact || records_since_compaction_ >= compact_after_) write_compacted();
+      {
+        std::scoped_lock l(mutex_);
+        written_ = target;
+      }
+      cv_.notify_all();
+    }
+  }
+
+  void StateJournal::write_records(const std::vector<Record>& records)
+  {
+    if (records.empty()) return;
+    if (journal_ == nullptr) journal_ = std::fopen(journal_path_.c_str(), "a");
+    if (journal_ == nullptr) {
+      LOGE("Could not open state journal {}", journal_path_);
+    }
+    for (const auto& r : records) {
+      at_path(document_, r.path) = r.value;
+      if (journal_ == nullptr) continue;
+      const auto line = json::value{{"path", r.path}, {"value", r.value}}.dump() + '\n';
+      std::fputs(line.c_str(), journal_);
+    }
+    records_since_compaction_ += records.size();
+    if (journal_ != nullptr && !sync_file(journal_)) {
+      LOGE("Could not write state journal {}", journal_path_);
+    }
+  }
+
+  void StateJournal::write_compacted()
+  {
+    auto tmp_path = state_path_;
+    tmp_path += ".tmp";
+    std::FILE* f = std::fopen(tmp_path.c_str(), "w");
+    if (f == nullptr) {
+      LOGE("Could not open {} for writing", tmp_path);
+      return;
+    }
+    const auto data = json::dump(document_, json::format_of(state_path_));
+    const bool ok = std::fwrite(data.data(), 1, data.size(), f) == data.size() && sync_file(f);
+    std::fclose(f);
+    if (!ok) {
+      LOGE("Could not write {}", tmp_path);
+      return;
+    }
+    // Atomically replace the state file, so it is either the old or the new state after a crash
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, state_path_, ec);
+    if (ec) {
+      LOGE("Could not replace {}: {}", state_path_, ec.message());
+      return;
+    }
+    // The records are in the state file now. If this is cut short by a crash,
+    // replaying them again on top of the new state file gives the same result.
+    if (journal_ != nullptr) std::fclose(journal_);
+    journal_ = std::fopen(journal_path_.c_str(), "w");
+    records_since_compaction_ = 0;
+  }
+
+  json::value StateJournal::load(const std::filesystem::path& state_path)
+  {
+    json::value res;
+    if (std::filesystem::exists(json::find_file(state_path))) res = json::parse_file(state_path);
+    std::ifstream journal(journal_path(state_path));
+    std::size_t count = 0;
+    for (std::string line; std::getline(journal, line);) {
+      const auto record = json::value::parse(line, nullptr, false);
+      if (record.is_discarded() || !record.contains("path") || !record.contains("value")) {
+        LOGW("Ignoring the end of the state journal after {} records, it was not completely written", count);
+        break;
+      }
+      try {
+        at_path(res, record["path"].get<std::vector<std::string>>()) = record["value"];
+      } catch (json::value::exception& e) {
+        LOGW("Invalid state journal record: {}", e.what());
+        break;
+      }
+      count++;
+    }
+    if (count > 0) LOGI("Replayed {} state journal records", count);
+    return res;
+  }
+
+} // namespace otto::services
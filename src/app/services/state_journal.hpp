@@ -0,0 +1,85 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lib/json.hpp"
+
+namespace otto::services {
+
+  /// Crash-safe, append-only journal of state changes, written on a background thread.
+  ///
+  /// Each record replaces the json value at a path in the state document, and is appended to
+  /// `<state file>.journal` as one line. The I/O thread keeps the whole document in memory,
+  /// and compacts the journal into the state file once it has grown, by writing a temporary
+  /// file and renaming it over the state file. At no point is the state on disk incomplete:
+  /// after a crash, `load` reads the state file and replays the journal on top of it.
+  /// A record that was cut off while being written is ignored.
+  struct StateJournal {
+    struct Record {
+      /// Keys of the value in the state document
+      std::vector<std::string> path;
+      json::value value;
+    };
+
+    /// The number of records after which the journal is compacted
+    static constexpr std::size_t default_compact_after = 256;
+
+    /// Start the I/O thread. The state file and journal are compacted from `document` right away.
+    StateJournal(std::filesystem::path state_path, json::value document,
+                 std::size_t compact_after = default_compact_after);
+
+    /// Writes the pending records and stops the I/O thread, without compacting
+    ~StateJournal() noexcept;
+
+    StateJournal(const StateJournal&) = delete;
+    StateJournal& operator=(const StateJournal&) = delete;
+
+    /// Queue records to be appended. Only takes a lock to move them to the I/O thread.
+    void append(std::vector<Record>&& records);
+
+    /// Compact the journal into the state file, after the records appended so far
+    void compact();
+
+    /// Block until the records appended and compactions requested so far are written
+    void flush();
+
+    /// Read the state file, and replay the journal on top of it
+    ///
+    /// @return the state document, or null if there is neither a state file nor a journal
+    static json::value load(const std::filesystem::path& state_path);
+
+    static std::filesystem::path journal_path(const std::filesystem::path& state_path);
+
+  private:
+    void run(const std::stop_token& stop);
+    void write_records(const std::vector<Record>& records);
+    void write_compacted();
+
+    std::filesystem::path state_path_;
+    std::filesystem::path journal_path_;
+    std::size_t compact_after_;
+
+    std::mutex mutex_;
+    std::condition_variable_any cv_;
+    /// Records appended, but not picked up by the I/O thread
+    std::vector<Record> queue_;
+    bool compact_requested_ = false;
+    /// Incremented for each request, to implement `flush`. The first is the initial compaction.
+    std::uint64_t requested_ = 1;
+    std::uint64_t written_ = 0;
+
+    // Only accessed by the I/O thread
+    json::value document_;
+    std::FILE* journal_ = nullptr;
+    std::size_t records_since_compaction_ = 0;
+
+    std::jthread thread_;
+  };
+
+} // namespace otto::services
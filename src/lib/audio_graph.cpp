@@ -0,0 +1,324 @@
+#include "audio_graph.hpp"
+
+#include <algorithm>
+#include <deque>
+
+#if __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "lib/logging.hpp"
+
+namespace otto {
+
+  namespace {
+    /// Try to give the calling thread real-time priority. Fails silently without permissions.
+    void set_realtime_priority() noexcept
+    {
+#if __linux__
+      sched_param param = {};
+      param.sched_priority = sched_get_priority_max(SCHED_FIFO) - 1;
+      if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0) {
+        DLOGI("Could not set real-time priority for audio graph worker");
+      }
+#endif
+    }
+  } // namespace
+
+  AudioGraph::AudioGraph(std::size_t max_workers) : max_workers_(max_workers) {}
+
+  AudioGraph::~AudioGraph() noexcept
+  {
+    for (auto& w : workers_) w.request_stop();
+    // Wake the workers up, so they can see the stop request
+    block_.fetch_add(1, std::memory_order_release);
+    block_.notify_all();
+    workers_.clear();
+  }
+
+  std::size_t AudioGraph::default_worker_count() noexcept
+  {
+    // Keep a few cores free for the UI and logic threads
+    constexpr std::size_t max_workers = 3;
+    const std::size_t cores = std::thread::hardware_concurrency();
+    return cores > 1 ? std::min(cores - 1, max_workers) : 0;
+  }
+
+  AudioGraph::NodeId AudioGraph::add_node(std::string name, ProcessFunc&& process, std::size_t output_count)
+  {
+    auto node = std::make_unique<Node>();
+    node->name = std::move(name);
+    node->process = std::move(process);
+    node->output_buffer_count = output_count;
+    node->bound_outputs.resize(output_count);
+    compiled_ = false;
+    nodes_.push_back(std::move(node));
+    // Each node is pushed to the ready queue once per block
+    ready_capacity_ = nodes_.size();
+    ready_ = std::make_unique<std::atomic<std::uint64_t>[]>(ready_capacity_);
+    return nodes_.size() - 1;
+  }
+
+  bool AudioGraph::reaches(NodeId from, NodeId to) const
+  {
+    std::vector<bool> visited(nodes_.size(), false);
+    std::deque<NodeId> queue = {from};
+    while (!queue.empty()) {
+      const NodeId id = queue.front();
+      queue.pop_front();
+      if (id == to) return true;
+      if (visited[id]) continue;
+      visited[id] = true;
+      for (NodeId o : nodes_[id]->outputs) queue.push_back(o);
+    }
+    return false;
+  }
+
+  void AudioGraph::connect(NodeId from, NodeId to)
+  {
+    if (from >= nodes_.size() || to >= nodes_.size()) {
+      throw util::exception("Invalid audio graph node id {} -> {}", from, to);
+    }
+    if (reaches(to, from)) {
+      throw util::exception("Connecting '{}' to '{}' would create a cycle in the audio graph", name(from), name(to));
+    }
+    auto& outputs = nodes_[from]->outputs;
+    if (std::ranges::find(outputs, to) != outputs.end()) return;
+    outputs.push_back(to);
+    nodes_[to]->input_count++;
+    compiled_ = false;
+  }
+
+  std::vector<AudioGraph::NodeId> AudioGraph::schedule() const
+  {
+    // Kahn's algorithm
+    std::vector<std::size_t> pending(nodes_.size());
+    std::vector<NodeId> res;
+    res.reserve(nodes_.size());
+    for (NodeId id = 0; id < nodes_.size(); id++) {
+      pending[id] = nodes_[id]->input_count;
+      if (pending[id] == 0) res.push_back(id);
+    }
+    for (std::size_t i = 0; i < res.size(); i++) {
+      for (NodeId o : nodes_[res[i]]->outputs) {
+        if (--pending[o] == 0) res.push_back(o);
+      }
+    }
+    OTTO_ASSERT(res.size() == nodes_.size(), "Cycles are rejected by connect");
+    return res;
+  }
+
+  AudioGraph::BufferPlan AudioGraph::plan_buffers() const
+  {
+    const auto order = schedule();
+    const std::size_t n = nodes_.size();
+
+    // ancestors[a][b] is true if `b` is always done before `a` starts
+    std::vector<std::vector<bool>> ancestors(n, std::vector<bool>(n, false));
+    for (NodeId id : order) {
+      for (NodeId o : nodes_[id]->outputs) {
+        ancestors[o][id] = true;
+        for (NodeId a = 0; a < n; a++) {
+          if (ancestors[id][a]) ancestors[o][a] = true;
+        }
+      }
+    }
+
+    BufferPlan plan;
+    plan.slots.resize(n);
+    // The node whose buffer is in each slot
+    std::vector<NodeId> slot_owner;
+    const auto is_free_for = [&](std::size_t slot, NodeId id) {
+      const auto& owner = *nodes_[slot_owner[slot]];
+      // Sink buffers are read after the block
+      if (owner.outputs.empty()) return false;
+      // All users of the buffer must be done before this node starts. Reusing the
+      // buffer of an input in place is not allowed, since the node may read it after writing.
+      return std::ranges::all_of(owner.outputs, [&](NodeId user) { return ancestors[id][user]; });
+    };
+    for (NodeId id : order) {
+      for (std::size_t i = 0; i < nodes_[id]->output_buffer_count; i++) {
+        std::size_t slot = 0;
+        for (; slot < slot_owner.size(); slot++) {
+          if (is_free_for(slot, id)) break;
+        }
+        if (slot == slot_owner.size()) {
+          slot_owner.push_back(id);
+        } else {
+          slot_owner[slot] = id;
+        }
+        plan.slots[id].push_back(slot);
+      }
+    }
+    plan.slot_count = slot_owner.size();
+    return plan;
+  }
+
+  void AudioGraph::compile(util::AudioBufferPool& pool)
+  {
+    compiled_ = false;
+    // Return the buffers of the previous plan first, they may be in the same pool
+    slot_buffers_.clear();
+    plan_ = plan_buffers();
+    slot_buffers_.reserve(plan_.slot_count);
+    for (std::size_t i = 0; i < plan_.slot_count; i++) {
+      auto buf = pool.try_allocate();
+      if (!buf) {
+        slot_buffers_.clear();
+        throw util::exception("The audio graph needs {} buffers, but the pool only has {} free", plan_.slot_count, i);
+      }
+      std::ranges::fill(*buf, 0.f);
+      slot_buffers_.push_back(std::move(*buf));
+    }
+    buffer_size_ = pool.buffer_size();
+    compiled_ = true;
+
+    // The calling thread runs one of the parallel nodes
+    const std::size_t worker_count = std::min(max_workers_, max_width(schedule()) - 1);
+    while (workers_.size() < worker_count) {
+      workers_.emplace_back([this](const std::stop_token& stop) { worker_loop(stop); });
+    }
+  }
+
+  void AudioGraph::compile(std::size_t buffer_size)
+  {
+    slot_buffers_.clear();
+    own_pool_.emplace(plan_buffers().slot_count, buffer_size);
+    compile(*own_pool_);
+  }
+
+  std::size_t AudioGraph::max_width(const std::vector<NodeId>& order) const
+  {
+    if (order.empty()) return 1;
+    std::vector<std::size_t> depth(nodes_.size(), 0);
+    for (NodeId id : order) {
+      for (NodeId o : nodes_[id]->outputs) depth[o] = std::max(depth[o], depth[id] + 1);
+    }
+    std::vector<std::size_t> width(nodes_.size(), 0);
+    for (std::size_t d : depth) width[d]++;
+    return std::ranges::max(width);
+  }
+
+  util::audio_buffer AudioGraph::output(NodeId node, std::size_t idx) noexcept
+  {
+    OTTO_ASSERT(compiled_, "AudioGraph::compile must be called before using output buffers");
+    OTTO_ASSERT(idx < plan_.slots[node].size());
+    if (const auto bound = nodes_[node]->bound_outputs[idx]; !bound.empty()) {
+      OTTO_ASSERT(nframes_ <= bound.size(), "Bound output of {} is shorter than the block", nodes_[node]->name);
+      return util::audio_buffer(bound.first(nframes_), nullptr);
+    }
+    const std::size_t slot = plan_.slots[node][idx];
+    return util::audio_buffer(std::span(slot_buffers_[slot].data(), nframes_), nullptr);
+  }
+
+  void AudioGraph::bind_output(NodeId node, std::size_t idx, std::span<float> buffer) noexcept
+  {
+    OTTO_ASSERT(idx < nodes_[node]->output_buffer_count);
+    nodes_[node]->bound_outputs[idx] = buffer;
+  }
+
+  void AudioGraph::process(std::size_t nframes, chrono::time_point deadline) noexcept
+  {
+    if (nodes_.empty()) return;
+    OTTO_ASSERT(compiled_ || std::ranges::none_of(nodes_, [](auto& n) { return n->output_buffer_count > 0; }),
+                "AudioGraph::compile must be called before processing nodes with outputs");
+    OTTO_ASSERT(!compiled_ || nframes <= buffer_size_);
+    nframes_ = nframes;
+    deadline_ = deadline;
+    missed_deadline_.store(false, std::memory_order_relaxed);
+    completed_.store(0, std::memory_order_relaxed);
+    write_pos_.store(0, std::memory_order_relaxed);
+
+    const std::uint64_t block = block_.load(std::memory_order_relaxed) + 1;
+    read_pos_.store(block << 32, std::memory_order_relaxed);
+    for (NodeId id = 0; id < nodes_.size(); id++) {
+      auto& node = *nodes_[id];
+      node.pending.store(node.input_count, std::memory_order_relaxed);
+      if (node.input_count == 0) push_ready(block, id);
+    }
+
+    // Publish the block to the workers
+    block_.store(block, std::memory_order_release);
+    if (!workers_.empty()) block_.notify_all();
+
+    // Returns when all nodes are done
+    run_nodes();
+    if (missed_deadline_.load(std::memory_order_relaxed)) {
+      deadline_misses_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  void AudioGraph::worker_loop(const std::stop_token& stop) noexcept
+  {
+    set_realtime_priority();
+    std::uint64_t seen = block_.load(std::memory_order_acquire);
+    while (!stop.stop_requested()) {
+      block_.wait(seen, std::memory_order_acquire);
+      seen = block_.load(std::memory_order_acquire);
+      if (stop.stop_requested()) return;
+      run_nodes();
+    }
+  }
+
+  void AudioGraph::run_nodes() noexcept
+  {
+    while (true) {
+      // Loaded before checking the queue, so a push after the check ends the wait
+      const std::uint32_t seq = ready_seq_.load(std::memory_order_acquire);
+      const std::uint64_t block = block_.load(std::memory_order_acquire);
+      if (auto id = pop_ready(block)) {
+        run_node(block, *id);
+        continue;
+      }
+      if (completed_.load(std::memory_order_acquire) >= nodes_.size()) return;
+      // Spinning would starve lower priority threads, since the workers are real-time
+      ready_seq_.wait(seq, std::memory_order_acquire);
+    }
+  }
+
+  void AudioGraph::notify_ready() noexcept
+  {
+    ready_seq_.fetch_add(1, std::memory_order_acq_rel);
+    ready_seq_.notify_all();
+  }
+
+  void AudioGraph::run_node(std::uint64_t block, NodeId id) noexcept
+  {
+    auto& node = *nodes_[id];
+    if (chrono::clock::now() < deadline_) {
+      node.process(nframes_);
+    } else {
+      missed_deadline_.store(true, std::memory_order_relaxed);
+    }
+    for (NodeId o : node.outputs) {
+      if (nodes_[o]->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) push_ready(block, o);
+    }
+    if (completed_.fetch_add(1, std::memory_order_acq_rel) + 1 == nodes_.size()) notify_ready();
+  }
+
+  void AudioGraph::push_ready(std::uint64_t block, NodeId id) noexcept
+  {
+    const std::size_t pos = write_pos_.fetch_add(1, std::memory_order_relaxed);
+    OTTO_ASSERT(pos < ready_capacity_);
+    ready_[pos].store((block << 32) | id, std::memory_order_release);
+    notify_ready();
+  }
+
+  tl::optional<AudioGraph::NodeId> AudioGraph::pop_ready(std::uint64_t block) noexcept
+  {
+    std::uint64_t read = read_pos_.load(std::memory_order_acquire);
+    while (true) {
+      if ((read >> 32) != (block & index_mask)) return tl::nullopt;
+      const std::size_t pos = read & index_mask;
+      if (pos >= ready_capacity_) return tl::nullopt;
+      const std::uint64_t entry = ready_[pos].load(std::memory_order_acquire);
+      // Not pushed yet in this block
+      if ((entry >> 32) != (block & index_mask)) return tl::nullopt;
+      if (read_pos_.compare_exchange_weak(read, read + 1, std::memory_order_acq_rel)) {
+        return static_cast<NodeId>(entry & index_mask);
+      }
+    }
+  }
+
+} // namespace otto
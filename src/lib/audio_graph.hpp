@@ -0,0 +1,209 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <function2/function2.hpp>
+#include <tl/optional.hpp>
+
+#include "lib/chrono.hpp"
+#include "lib/util/audio_buffer.hpp"
+#include "lib/util/exception.hpp"
+
+namespace otto {
+
+  /// A directed acyclic graph of audio processing nodes, such as midi effects,
+  /// synths, effects and the master stage.
+  ///
+  /// An edge from `a` to `b` means `b` uses the output of `a`, so `a` is processed first.
+  ///
+  /// Nodes can have output buffers, which are planned ahead of time by `compile`. Like
+  /// register allocation, buffers share slots in one buffer pool when their lifetimes do not
+  /// overlap, so the graph needs no allocation while processing, and can not run out of
+  /// buffers. Nodes can also write to buffers they own, like the driver output.
+  ///
+  /// Each block, nodes whose inputs are done are put in a lock-free ready queue, which
+  /// the audio thread and a pool of worker threads take nodes from. This way, independent
+  /// chains are processed in parallel. Workers are only started by `compile` when the graph
+  /// has parallel branches, and sleep on a futex while there is nothing for them to do.
+  ///
+  /// The graph must not be modified while a block is processed.
+  struct AudioGraph {
+    using NodeId = std::size_t;
+    using ProcessFunc = fu2::unique_function<void(std::size_t nframes) noexcept>;
+
+    /// Construct a graph that uses up to `max_workers` worker threads.
+    ///
+    /// With no workers, all nodes are processed on the thread calling `process`.
+    explicit AudioGraph(std::size_t max_workers = default_worker_count());
+    ~AudioGraph() noexcept;
+
+    AudioGraph(const AudioGraph&) = delete;
+    AudioGraph& operator=(const AudioGraph&) = delete;
+
+    /// One worker per core, except the one running the audio callback, up to 3
+    [[nodiscard]] static std::size_t default_worker_count() noexcept;
+
+    /// Which slot of the pool each output buffer uses
+    struct BufferPlan {
+      /// The number of buffers taken from the pool
+      std::size_t slot_count = 0;
+      /// `slots[node][output]` is the slot of that output
+      std::vector<std::vector<std::size_t>> slots;
+    };
+
+    /// Add a node. `process` is called once per block, on any of the threads.
+    ///
+    /// `output_count` is the number of output buffers of the node, see `output`.
+    NodeId add_node(std::string name, ProcessFunc&& process, std::size_t output_count = 0);
+
+    /// Make `to` depend on the output of `from`
+    ///
+    /// @throws util::exception if the edge would create a cycle
+    void connect(NodeId from, NodeId to);
+
+    /// The nodes in a valid processing order
+    [[nodiscard]] std::vector<NodeId> schedule() const;
+
+    /// Plan the output buffers, without allocating them. See `compile`.
+    ///
+    /// An output buffer is live from when its node starts until all nodes connected to it are done.
+    /// A slot is only reused by a node that is ordered after all users of the previous buffer,
+    /// so the plan also holds when nodes run in parallel. Buffers of nodes with no outgoing
+    /// connections are never reused, so they can be read after `process`.
+    [[nodiscard]] BufferPlan plan_buffers() const;
+
+    /// Plan the output buffers, and take one buffer of `pool` for each slot of the plan.
+    ///
+    /// The buffers are returned to the pool when the graph is compiled again or destroyed,
+    /// so the pool must outlive the graph. Blocks can be up to the pool's buffer size.
+    ///
+    /// Also starts one worker per node that can run in parallel with another, up to the maximum
+    /// given to the constructor. A chain needs no workers. Without `compile`, nodes run on the
+    /// thread calling `process`.
+    ///
+    /// Must be called after the graph is built, and before `process` if any node has outputs.
+    ///
+    /// @throws util::exception if the pool does not have a free buffer for every slot
+    void compile(util::AudioBufferPool& pool);
+
+    /// Like `compile(pool)`, with a pool of its own that has exactly one buffer per slot,
+    /// of `buffer_size` frames.
+    void compile(std::size_t buffer_size);
+
+    [[nodiscard]] const BufferPlan& buffer_plan() const noexcept
+    {
+      return plan_;
+    }
+
+    /// The size of the output buffers in bytes
+    [[nodiscard]] std::size_t arena_bytes() const noexcept
+    {
+      return slot_buffers_.size() * buffer_size_ * sizeof(float);
+    }
+
+    /// Output buffer `idx` of `node`, with the length of the current block.
+    ///
+    /// Nodes write to their own outputs, and read the outputs of the nodes connected to them.
+    /// This is the buffer bound with `bind_output` if there is one, and its planned slot otherwise.
+    [[nodiscard]] util::audio_buffer output(NodeId node, std::size_t idx) noexcept;
+
+    /// Make output `idx` of `node` use `buffer` instead of its planned slot, until it is bound again.
+    ///
+    /// Used to let the last node write straight into the driver output. `buffer` must hold at least
+    /// the frames of each block processed while it is bound. Bind an empty span to use the slot again.
+    /// Must not be called while a block is processed.
+    void bind_output(NodeId node, std::size_t idx, std::span<float> buffer) noexcept;
+
+    /// Process one block of `nframes` frames.
+    ///
+    /// Blocks until all nodes are done. Nodes that have not started when `deadline`
+    /// has passed are skipped for this block, see `deadline_misses`.
+    void process(std::size_t nframes, chrono::time_point deadline = chrono::time_point::max()) noexcept;
+
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+      return nodes_.size();
+    }
+
+    [[nodiscard]] const std::string& name(NodeId id) const noexcept
+    {
+      return nodes_[id]->name;
+    }
+
+    /// The number of worker threads started by `compile`
+    [[nodiscard]] std::size_t worker_count() const noexcept
+    {
+      return workers_.size();
+    }
+
+    /// The number of blocks in which nodes were skipped because of the deadline
+    [[nodiscard]] std::size_t deadline_misses() const noexcept
+    {
+      return deadline_misses_.load(std::memory_order_relaxed);
+    }
+
+  private:
+    struct Node {
+      std::string name;
+      ProcessFunc process;
+      std::vector<NodeId> outputs;
+      std::size_t input_count = 0;
+      std::size_t output_buffer_count = 0;
+      /// Set by `bind_output`, empty for outputs that use their planned slot
+      std::vector<std::span<float>> bound_outputs;
+      /// Number of inputs not yet done in the current block
+      std::atomic<std::size_t> pending = 0;
+    };
+
+    /// Ready queue entries and the read position are tagged with the block number
+    /// in the upper 32 bits, so threads that are late from the previous block
+    /// can not take nodes of the current one by mistake.
+    static constexpr std::uint64_t index_mask = 0xFFFF'FFFF;
+
+    void worker_loop(const std::stop_token& stop) noexcept;
+    /// The most nodes that are at the same depth, i.e. the length of the longest path to them
+    [[nodiscard]] std::size_t max_width(const std::vector<NodeId>& order) const;
+    /// Wake the threads waiting for the ready queue to change
+    void notify_ready() noexcept;
+    /// Process nodes from the ready queue until the block is done
+    void run_nodes() noexcept;
+    void run_node(std::uint64_t block, NodeId id) noexcept;
+    void push_ready(std::uint64_t block, NodeId id) noexcept;
+    tl::optional<NodeId> pop_ready(std::uint64_t block) noexcept;
+    [[nodiscard]] bool reaches(NodeId from, NodeId to) const;
+
+    std::vector<std::unique_ptr<Node>> nodes_;
+    std::unique_ptr<std::atomic<std::uint64_t>[]> ready_;
+    std::size_t ready_capacity_ = 0;
+
+    std::atomic<std::uint64_t> block_ = 0;
+    std::atomic<std::uint64_t> read_pos_ = 0;
+    std::atomic<std::size_t> write_pos_ = 0;
+    std::atomic<std::size_t> completed_ = 0;
+    /// Incremented after a node is pushed to the ready queue, and when the block is done.
+    /// Threads with nothing to do wait on it.
+    std::atomic<std::uint32_t> ready_seq_ = 0;
+    std::atomic<bool> missed_deadline_ = false;
+    std::atomic<std::size_t> deadline_misses_ = 0;
+    std::size_t nframes_ = 0;
+    chrono::time_point deadline_;
+
+    BufferPlan plan_;
+    std::size_t buffer_size_ = 0;
+    /// Only used by `compile(buffer_size)`. Declared first, so the buffers are returned before it is destroyed.
+    tl::optional<util::AudioBufferPool> own_pool_;
+    /// One buffer per slot of the plan
+    std::vector<util::audio_buffer> slot_buffers_;
+    bool compiled_ = false;
+
+    std::size_t max_workers_ = 0;
+    std::vector<std::jthread> workers_;
+  };
+
+} // namespace otto
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace otto {
+
+  /// Lock-free statistics of the time spent in the audio callback.
+  ///
+  /// The load of a callback is its processing time as a fraction of the buffer period,
+  /// i.e. a load above 1 means the callback took longer than the audio it rendered.
+  ///
+  /// `record` must only be called from one thread, the audio thread, while
+  /// `snapshot` and `reset` can be called from any thread.
+  struct AudioTimingStats {
+    /// Number of histogram buckets
+    static constexpr std::size_t bucket_count = 20;
+    /// The load range of each bucket. The last bucket also counts all loads above it.
+    static constexpr float bucket_width = 0.1f;
+
+    struct Snapshot {
+      std::array<std::uint64_t, bucket_count> histogram = {};
+      std::uint64_t callbacks = 0;
+      /// Over/underruns reported by the driver
+      std::uint64_t xruns = 0;
+      /// Callbacks with a load above 1
+      std::uint64_t overruns = 0;
+      float peak_load = 0;
+      float mean_load = 0;
+
+      /// The load that a fraction `p` of the callbacks stayed below, at the resolution of the buckets.
+      [[nodiscard]] float percentile(float p) const noexcept
+      {
+        std::uint64_t total = 0;
+        for (auto n : histogram) total += n;
+        if (total == 0) return 0;
+        std::uint64_t acc = 0;
+        for (std::size_t i = 0; i < bucket_count; i++) {
+          acc += histogram[i];
+          if (acc > 0 && static_cast<float>(acc) >= p * static_cast<float>(total)) {
+            return static_cast<float>(i + 1) * bucket_width;
+          }
+        }
+        return static_cast<float>(bucket_count) * bucket_width;
+      }
+    };
+
+    /// Record one callback with the given load
+    void record(float load, bool xrun = false) noexcept
+    {
+      if (reset_requested_.exchange(false, std::memory_order_acquire)) clear();
+      const auto bucket = std::min(static_cast<std::size_t>(std::max(load, 0.f) / bucket_width), bucket_count - 1);
+      increment(histogram_[bucket]);
+      increment(callbacks_);
+      if (xrun) increment(xruns_);
+      if (load > 1.f) increment(overruns_);
+      if (load > peak_load_.load(std::memory_order_relaxed)) peak_load_.store(load, std::memory_order_relaxed);
+      load_sum_.store(load_sum_.load(std::memory_order_relaxed) + load, std::memory_order_relaxed);
+    }
+
+    /// Get the current statistics.
+    ///
+    /// The fields are read one by one, so they may be off by a callback from each other.
+    [[nodiscard]] Snapshot snapshot() const noexcept
+    {
+      Snapshot res;
+      for (std::size_t i = 0; i < bucket_count; i++) res.histogram[i] = histogram_[i].load(std::memory_order_relaxed);
+      res.callbacks = callbacks_.load(std::memory_order_relaxed);
+      res.xruns = xruns_.load(std::memory_order_relaxed);
+      res.overruns = overruns_.load(std::memory_order_relaxed);
+      res.peak_load = peak_load_.load(std::memory_order_relaxed);
+      if (res.callbacks > 0) {
+        res.mean_load = static_cast<float>(load_sum_.load(std::memory_order_relaxed) / static_cast<double>(res.callbacks));
+      }
+      return res;
+    }
+
+    /// Clear the statistics before the next recorded callback
+    void reset() noexcept
+    {
+      reset_requested_.store(true, std::memory_order_release);
+    }
+
+  private:
+    /// Only the recording thread writes, so a load and a store is enough
+    static void increment(std::atomic<std::uint64_t>& a) noexcept
+    {
+      a.store(a.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void clear() noexcept
+    {
+      for (auto& n : histogram_) n.store(0, std::memory_order_relaxed);
+      callbacks_.store(0, std::memory_order_relaxed);
+      xruns_.store(0, std::memory_order_relaxed);
+      overruns_.store(0, std::memory_order_relaxed);
+      peak_load_.store(0, std::memory_order_relaxed);
+      load_sum_.store(0, std::memory_order_relaxed);
+    }
+
+    std::array<std::atomic<std::uint64_t>, bucket_count> histogram_ = {};
+    std::atomic<std::uint64_t> callbacks_ = 0;
+    std::atomic<std::uint64_t> xruns_ = 0;
+    std::atomic<std::uint64_t> overruns_ = 0;
+    std::atomic<float> peak_load_ = 0;
+    std::atomic<double> load_sum_ = 0;
+    std::atomic<bool> reset_requested_ = false;
+  };
+
+} // namespace otto
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+
+#include <Gamma/Domain.h>
+
+namespace otto::dsp {
+
+  /// A Gamma domain running at a fraction of the master sample rate.
+  ///
+  /// Attach envelopes, glides and other `gam::DomainObserver`s to it to step them
+  /// once per control period instead of once per sample. Their lengths are still
+  /// specified in seconds. The rate follows changes to the master domain.
+  struct ControlDomain : gam::Domain, private gam::DomainObserver {
+    /// The default number of audio frames per control frame
+    static constexpr std::size_t default_decimation = 16;
+
+    explicit ControlDomain(std::size_t decimation = default_decimation) noexcept : decimation_(decimation)
+    {
+      update();
+    }
+
+    using gam::Domain::spu;
+    using gam::Domain::ups;
+
+    /// The number of audio frames per control frame
+    [[nodiscard]] std::size_t decimation() const noexcept
+    {
+      return decimation_;
+    }
+
+    /// Set the number of audio frames per control frame
+    void decimation(std::size_t d) noexcept
+    {
+      decimation_ = d < 1 ? 1 : d;
+      update();
+    }
+
+    /// The control domain used by the voices and engines
+    static ControlDomain& master() noexcept
+    {
+      static ControlDomain instance;
+      return instance;
+    }
+
+  private:
+    void onDomainChange(double) override
+    {
+      update();
+    }
+
+    void update() noexcept
+    {
+      gam::Domain::spu(gam::DomainObserver::spu() / double(decimation_));
+    }
+
+    std::size_t decimation_;
+  };
+
+  /// A value that is calculated at control rate, and linearly interpolated at audio rate.
+  ///
+  /// Every `decimation` frames, the next target is calculated, and the value ramps
+  /// to it over the following control period. This delays the value by one control period.
+  template<typename T = float>
+  struct ControlRateValue {
+    explicit ControlRateValue(T init = {}, const ControlDomain& domain = ControlDomain::master()) noexcept
+      : domain_(&domain), value_(init)
+    {}
+
+    /// Get the next audio rate value.
+    ///
+    /// `calc` is called once per control period, and should return the next target.
+    /// Typically, it steps an object attached to the control domain.
+    template<typename F>
+    T operator()(F&& calc) noexcept
+    {
+      if (counter_ == 0) {
+        counter_ = domain_->decimation();
+        step_ = (calc() - value_) / T(counter_);
+      }
+      counter_--;
+      value_ += step_;
+      return value_;
+    }
+
+    /// Set the value immediately, skipping the interpolation.
+    ///
+    /// The next target is calculated on the next call.
+    void jump(T v) noexcept
+    {
+      value_ = v;
+      step_ = T{};
+      counter_ = 0;
+    }
+
+    /// The current value
+    [[nodiscard]] T value() const noexcept
+    {
+      return value_;
+    }
+
+    /// Whether the value is still moving towards the last target
+    [[nodiscard]] bool is_ramping() const noexcept
+    {
+      return counter_ > 0 && step_ != T{};
+    }
+
+  private:
+    const ControlDomain* domain_;
+    T value_;
+    T step_ = {};
+    std::size_t counter_ = 0;
+  };
+
+} // namespace otto::dsp
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+/// Set to 0 to force the scalar fallback of the lane types
+#ifndef OTTO_DSP_SIMD
+#if defined(__GNUC__) || defined(__clang__)
+#define OTTO_DSP_SIMD 1
+#else
+#define OTTO_DSP_SIMD 0
+#endif
+#endif
+
+namespace otto::dsp::simd {
+
+  /// Number of lanes in the lane types
+  constexpr std::size_t lanes = 8;
+
+#if OTTO_DSP_SIMD
+
+  /// 8 lanes of float, using the GCC/Clang vector extensions
+  ///
+  /// These are lowered to whatever the target supports, i.e. two NEON/SSE
+  /// registers or one AVX register.
+  using float_x8 = float __attribute__((vector_size(lanes * sizeof(float))));
+  using int32_x8 = std::int32_t __attribute__((vector_size(lanes * sizeof(std::int32_t))));
+  using uint32_x8 = std::uint32_t __attribute__((vector_size(lanes * sizeof(std::uint32_t))));
+
+  /// Convert to integers, truncating towards zero
+  inline int32_x8 to_int(float_x8 v) noexcept
+  {
+    return __builtin_convertvector(v, int32_x8);
+  }
+
+  inline float_x8 to_float(int32_x8 v) noexcept
+  {
+    return __builtin_convertvector(v, float_x8);
+  }
+
+  /// Reinterpret as signed, i.e. two's complement
+  inline int32_x8 as_signed(uint32_x8 v) noexcept
+  {
+    return reinterpret_cast<int32_x8>(v);
+  }
+
+  inline uint32_x8 as_unsigned(int32_x8 v) noexcept
+  {
+    return reinterpret_cast<uint32_x8>(v);
+  }
+
+#else
+
+  namespace detail {
+    /// Scalar fallback for the vector extension types. Operations are applied lane by lane.
+    template<typename T>
+    struct lanes_of {
+      std::array<T, lanes> data = {};
+
+      T& operator[](std::size_t i) noexcept
+      {
+        return data[i];
+      }
+      T operator[](std::size_t i) const noexcept
+      {
+        return data[i];
+      }
+
+      template<typename F>
+      friend lanes_of zip_with(lanes_of a, const lanes_of& b, F&& f) noexcept
+      {
+        for (std::size_t i = 0; i < lanes; i++) a[i] = f(a[i], b[i]);
+        return a;
+      }
+
+      friend lanes_of operator+(const lanes_of& a, const lanes_of& b) noexcept
+      {
+        return zip_with(a, b, [](T x, T y) -> T { return x + y; });
+      }
+      friend lanes_of operator-(const lanes_of& a, const lanes_of& b) noexcept
+      {
+        return zip_with(a, b, [](T x, T y) -> T { return x - y; });
+      }
+      friend lanes_of operator*(const lanes_of& a, const lanes_of& b) noexcept
+      {
+        return zip_with(a, b, [](T x, T y) -> T { return x * y; });
+      }
+      friend lanes_of operator+(const lanes_of& a, T b) noexcept
+      {
+        return a + splat(b);
+      }
+      friend lanes_of operator+(T a, const lanes_of& b) noexcept
+      {
+        return splat(a) + b;
+      }
+      friend lanes_of operator-(const lanes_of& a, T b) noexcept
+      {
+        return a - splat(b);
+      }
+      friend lanes_of operator*(const lanes_of& a, T b) noexcept
+      {
+        return a * splat(b);
+      }
+      friend lanes_of operator*(T a, const lanes_of& b) noexcept
+      {
+        return splat(a) * b;
+      }
+      friend lanes_of operator<<(lanes_of a, int n) noexcept
+      {
+        for (auto& x : a.data) x = x << n;
+        return a;
+      }
+      friend lanes_of operator>>(lanes_of a, int n) noexcept
+      {
+        for (auto& x : a.data) x = x >> n;
+        return a;
+      }
+      friend lanes_of operator&(const lanes_of& a, T b) noexcept
+      {
+        return zip_with(a, splat(b), [](T x, T y) -> T { return x & y; });
+      }
+      lanes_of& operator+=(const lanes_of& rhs) noexcept
+      {
+        return *this = *this + rhs;
+      }
+      lanes_of& operator-=(const lanes_of& rhs) noexcept
+      {
+        return *this = *this - rhs;
+      }
+
+      static lanes_of splat(T v) noexcept
+      {
+        lanes_of res;
+        res.data.fill(v);
+        return res;
+      }
+    };
+  } // namespace detail
+
+  using float_x8 = detail::lanes_of<float>;
+  using int32_x8 = detail::lanes_of<std::int32_t>;
+  using uint32_x8 = detail::lanes_of<std::uint32_t>;
+
+  /// Convert to integers, truncating towards zero
+  inline int32_x8 to_int(const float_x8& v) noexcept
+  {
+    int32_x8 res;
+    for (std::size_t i = 0; i < lanes; i++) res[i] = static_cast<std::int32_t>(v[i]);
+    return res;
+  }
+
+  inline float_x8 to_float(const int32_x8& v) noexcept
+  {
+    float_x8 res;
+    for (std::size_t i = 0; i < lanes; i++) res[i] = static_cast<float>(v[i]);
+    return res;
+  }
+
+  /// Reinterpret as signed, i.e. two's complement
+  inline int32_x8 as_signed(const uint32_x8& v) noexcept
+  {
+    int32_x8 res;
+    for (std::size_t i = 0; i < lanes; i++) res[i] = static_cast<std::int32_t>(v[i]);
+    return res;
+  }
+
+  inline uint32_x8 as_unsigned(const int32_x8& v) noexcept
+  {
+    uint32_x8 res;
+    for (std::size_t i = 0; i < lanes; i++) res[i] = static_cast<std::uint32_t>(v[i]);
+    return res;
+  }
+
+#endif
+
+  /// Sum of all lanes
+  inline float horizontal_sum(const float_x8& v) noexcept
+  {
+    float res = 0;
+    for (std::size_t i = 0; i < lanes; i++) res += v[i];
+    return res;
+  }
+
+} // namespace otto::dsp::simd
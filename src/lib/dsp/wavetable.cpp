@@ -0,0 +1,166 @@
+#include "wavetable.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numbers>
+#include <string_view>
+
+#include "lib/util/exception.hpp"
+#include "lib/util/mapped_file.hpp"
+
+namespace otto::dsp {
+
+  namespace {
+    /// Read a little endian value at `pos`
+    template<typename T>
+    T read_le(std::span<const std::byte> data, std::size_t pos)
+    {
+      if (pos + sizeof(T) > data.size()) throw util::exception("Wav file ended early");
+      T res;
+      std::memcpy(&res, data.data() + pos, sizeof(T));
+      return res;
+    }
+
+    bool has_id(std::span<const std::byte> data, std::size_t pos, std::string_view id)
+    {
+      return pos + id.size() <= data.size() && std::memcmp(data.data() + pos, id.data(), id.size()) == 0;
+    }
+
+    /// Silence for the lanes that are cleared
+    constexpr std::array<float, Wavetable::stride> silence = {};
+  } // namespace
+
+  Wavetable::Wavetable(std::span<const float> cycle) : data_(levels * stride, 0.f)
+  {
+    // The harmonics of the cycle, by direct DFT. The cycles are short, and this runs once per table.
+    const std::size_t n = cycle.size();
+    const std::size_t harmonics = n < 2 ? 0 : std::min((n - 1) / 2, max_harmonic(0));
+    std::vector<double> re(harmonics + 1);
+    std::vector<double> im(harmonics + 1);
+    for (std::size_t h = 1; h <= harmonics; h++) {
+      for (std::size_t k = 0; k < n; k++) {
+        const double w = 2 * std::numbers::pi * double(h * k % n) / double(n);
+        re[h] += cycle[k] * std::cos(w);
+        im[h] += cycle[k] * std::sin(w);
+      }
+      re[h] *= 2.0 / double(n);
+      im[h] *= 2.0 / double(n);
+    }
+
+    // Each level has all the harmonics of the one above it, so the sum is built from
+    // the top level down, adding each harmonic once
+    std::vector<double> sine(size);
+    for (std::size_t i = 0; i < size; i++) sine[i] = std::sin(2 * std::numbers::pi * double(i) / double(size));
+    std::vector<double> sum(size, 0.0);
+    std::size_t h = 1;
+    for (std::size_t l = levels; l-- > 0;) {
+      for (; h <= std::min(max_harmonic(l), harmonics); h++) {
+        for (std::size_t i = 0; i < size; i++) {
+          const std::size_t idx = h * i % size;
+          sum[i] += re[h] * sine[(idx + size / 4) % size] + im[h] * sine[idx];
+        }
+      }
+      auto out = data_.begin() + static_cast<std::ptrdiff_t>(l * stride);
+      std::ranges::transform(sum, out, [](double d) { return static_cast<float>(d); });
+      out[size] = out[0];
+    }
+
+    const auto level0 = level(0);
+    const float peak = std::abs(std::ranges::max(level0, {}, [](float f) { return std::abs(f); }));
+    if (peak > 0) {
+      for (float& f : data_) f /= peak;
+    }
+  }
+
+  Wavetable Wavetable::load(const std::filesystem::path& path)
+  {
+    util::MappedFile file(path);
+    try {
+      return Wavetable(decode_wav(file.bytes()));
+    } catch (util::exception& e) {
+      throw e.append(path.string());
+    }
+  }
+
+  std::size_t Wavetable::level_for(float cycles_per_sample) noexcept
+  {
+    // Level l has no aliasing when max_harmonic(l) * cycles_per_sample <= 0.5,
+    // so it is ceil(log2(size * cycles_per_sample))
+    const float x = float(size) * cycles_per_sample;
+    if (!(x > 1.f)) return 0;
+    int exp = 0;
+    const float mantissa = std::frexp(x, &exp);
+    const auto res = static_cast<std::size_t>(mantissa == 0.5f ? exp - 1 : exp);
+    return std::min(res, levels - 1);
+  }
+
+  std::vector<float> decode_wav(std::span<const std::byte> data)
+  {
+    if (!has_id(data, 0, "RIFF") || !has_id(data, 8, "WAVE")) throw util::exception("Not a wav file");
+    std::uint16_t format = 0;
+    std::uint16_t channels = 0;
+    std::uint16_t bits = 0;
+    for (std::size_t pos = 12; pos + 8 <= data.size();) {
+      const auto chunk_size = read_le<std::uint32_t>(data, pos + 4);
+      const std::size_t body = pos + 8;
+      if (has_id(data, pos, "fmt ")) {
+        format = read_le<std::uint16_t>(data, body);
+        channels = read_le<std::uint16_t>(data, body + 2);
+        bits = read_le<std::uint16_t>(data, body + 14);
+        // WAVE_FORMAT_EXTENSIBLE has the actual format at the start of the sub format GUID
+        if (format == 0xFFFE) format = read_le<std::uint16_t>(data, body + 24);
+      } else if (has_id(data, pos, "data")) {
+        const std::size_t frame_size = channels * (bits / 8u);
+        if (frame_size == 0) throw util::exception("Wav file has no format before the data");
+        const std::size_t frames = std::min<std::size_t>(chunk_size, data.size() - body) / frame_size;
+        std::vector<float> res(frames);
+        for (std::size_t i = 0; i < frames; i++) {
+          const std::size_t at = body + i * frame_size;
+          if (format == 3 && bits == 32) {
+            res[i] = read_le<float>(data, at);
+          } else if (format == 1 && bits == 16) {
+            res[i] = float(read_le<std::int16_t>(data, at)) / 0x1p15f;
+          } else if (format == 1 && bits == 24) {
+            // Shift the three bytes into the top of an int32, to keep the sign
+            const auto b = [&](std::size_t j) { return std::uint32_t(data[at + j]); };
+            const auto v = static_cast<std::int32_t>(b(0) << 8 | b(1) << 16 | b(2) << 24);
+            res[i] = float(v) / 0x1p31f;
+          } else if (format == 1 && bits == 32) {
+            res[i] = float(read_le<std::int32_t>(data, at)) / 0x1p31f;
+          } else {
+            throw util::exception("Unsupported wav format {} with {} bits", format, bits);
+          }
+        }
+        return res;
+      }
+      // Chunks are padded to an even size
+      pos = body + chunk_size + (chunk_size & 1u);
+    }
+    throw util::exception("Wav file has no data");
+  }
+
+  WavetableLanes::WavetableLanes() noexcept
+  {
+    from_.fill(silence.data());
+    to_.fill(silence.data());
+  }
+
+  void WavetableLanes::set(std::size_t lane, const Wavetable& from, const Wavetable& to, float morph,
+                           float cycles_per_sample) noexcept
+  {
+    const auto level = Wavetable::level_for(cycles_per_sample);
+    from_[lane] = from.level(level).data();
+    to_[lane] = to.level(level).data();
+    morph_[lane] = morph;
+    phase_inc_[lane] = static_cast<std::uint32_t>(static_cast<std::int64_t>(double(cycles_per_sample) * 0x1p32));
+  }
+
+  void WavetableLanes::clear(std::size_t lane) noexcept
+  {
+    from_[lane] = silence.data();
+    to_[lane] = silence.data();
+    phase_inc_[lane] = 0;
+  }
+
+} // namespace otto::dsp
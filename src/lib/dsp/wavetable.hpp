@@ -0,0 +1,114 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+#include "lib/dsp/simd.hpp"
+
+namespace otto::dsp {
+
+  /// A single cycle waveform, band-limited at several levels so it can be played at any pitch without aliasing.
+  ///
+  /// Level `l` holds the harmonics up to `max_harmonic(l)`, which halves from level to level.
+  /// Every level is resynthesized at `size` samples, followed by a copy of the first sample,
+  /// so interpolating between two neighbouring samples never has to wrap around.
+  struct Wavetable {
+    static constexpr std::size_t size_bits = 11;
+    /// The number of samples in each level
+    static constexpr std::size_t size = std::size_t{1} << size_bits;
+    static constexpr std::size_t levels = size_bits;
+    /// The distance between the starts of two levels
+    static constexpr std::size_t stride = size + 1;
+
+    /// Band-limit one cycle of a waveform, of any length.
+    ///
+    /// The DC offset is removed, and the levels are scaled so the peak of level 0 is 1.
+    explicit Wavetable(std::span<const float> cycle);
+
+    /// Read one cycle from a wav file. The file is memory mapped, and decoded in place.
+    ///
+    /// @throws util::exception if it is not a PCM or float wav file, or std::system_error if it can not be read
+    static Wavetable load(const std::filesystem::path& path);
+
+    /// The highest harmonic in level `l`
+    [[nodiscard]] static constexpr std::size_t max_harmonic(std::size_t l) noexcept
+    {
+      return size / 2 >> l;
+    }
+
+    /// The first level without harmonics above the nyquist frequency, at a frequency
+    /// of `cycles_per_sample`, i.e. the frequency divided by the sample rate.
+    [[nodiscard]] static std::size_t level_for(float cycles_per_sample) noexcept;
+
+    /// The `stride` samples of level `l`
+    [[nodiscard]] std::span<const float> level(std::size_t l) const noexcept
+    {
+      return {data_.data() + l * stride, stride};
+    }
+
+  private:
+    std::vector<float> data_;
+  };
+
+  /// The samples of the first channel of a wav file
+  ///
+  /// Supports 16, 24 and 32 bit integer, and 32 bit float samples.
+  ///
+  /// @throws util::exception if the data is not a supported wav file
+  std::vector<float> decode_wav(std::span<const std::byte> data);
+
+  /// Wavetable oscillators, one per SIMD lane, which crossfade between two tables each.
+  ///
+  /// The phases are 32 bit fixed point accumulators, where the full integer range is one period.
+  /// Reading the tables is a scalar gather, while the interpolation and crossfade are
+  /// calculated for all lanes at once. Lanes that are cleared read silence.
+  struct WavetableLanes {
+    WavetableLanes() noexcept;
+
+    /// Set the tables and frequency of `lane`, and pick the level for the frequency.
+    ///
+    /// The output is `from` when `morph` is 0, and `to` when it is 1.
+    /// The tables must outlive their use in this lane.
+    void set(std::size_t lane, const Wavetable& from, const Wavetable& to, float morph,
+             float cycles_per_sample) noexcept;
+
+    /// Silence `lane`, and hold its phase
+    void clear(std::size_t lane) noexcept;
+
+    /// The next sample of all lanes
+    simd::float_x8 operator()() noexcept
+    {
+      using namespace simd;
+      constexpr int frac_bits = 32 - Wavetable::size_bits;
+      constexpr std::uint32_t frac_mask = (std::uint32_t{1} << frac_bits) - 1;
+      float_x8 from0 = {};
+      float_x8 from1 = {};
+      float_x8 to0 = {};
+      float_x8 to1 = {};
+      for (std::size_t v = 0; v < lanes; v++) {
+        const std::uint32_t i = phase_[v] >> frac_bits;
+        from0[v] = from_[v][i];
+        from1[v] = from_[v][i + 1];
+        to0[v] = to_[v][i];
+        to1[v] = to_[v][i + 1];
+      }
+      const float_x8 frac = to_float(as_signed(phase_ & frac_mask)) * (1.f / float(frac_mask + 1));
+      phase_ += phase_inc_;
+      const float_x8 from = from0 + frac * (from1 - from0);
+      const float_x8 to = to0 + frac * (to1 - to0);
+      return from + morph_ * (to - from);
+    }
+
+  private:
+    std::array<const float*, simd::lanes> from_;
+    std::array<const float*, simd::lanes> to_;
+    simd::uint32_x8 phase_ = {};
+    simd::uint32_x8 phase_inc_ = {};
+    simd::float_x8 morph_ = {};
+  };
+
+} // namespace otto::dsp
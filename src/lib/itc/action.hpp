@@ -15,6 +15,23 @@ namespace otto::itc {
   template<AnAction... Actions>
   struct Receiver;
 
+  /// The executor priority of actions of type `Action`.
+  ///
+  /// Specialize this as `Priority::high` for actions that must not wait behind
+  /// state changes, like transport and note events.
+  template<AnAction Action>
+  constexpr Priority action_priority = Priority::normal;
+
+  /// Whether actions of type `Action` coalesce.
+  ///
+  /// A receiver only keeps the newest pending action of a coalescing type, and drops the
+  /// older ones, so it handles at most one per executor run. Other actions are all
+  /// received, in the order they were sent.
+  ///
+  /// Coalescing actions must be default constructible, and sent from one thread at a time.
+  template<AnAction Action>
+  constexpr bool action_coalesces = false;
+
   template<AnAction Action>
   struct action_service {
     using provider_t = Sender<Action>;
@@ -1,10 +1,15 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <tuple>
+
 #include "lib/util/concepts.hpp"
-#include "lib/util/spin_lock.hpp"
 
+#include "producer.hpp"
 #include "receiver.hpp"
 #include "state.hpp"
+#include "transaction.hpp"
 
 namespace otto::itc {
   // Declarations
@@ -36,41 +41,136 @@ namespace otto::itc {
     /// Override in subclass if needed
     virtual void on_state_change(const State& state) noexcept {}
 
+    /// The snapshots published by the producer, or nullptr if there is none
+    SnapshotBuffer<State>* snapshots() noexcept
+    {
+      if (snapshots_ == nullptr) {
+        // Nothing received yet, but a transaction may have published this state already
+        if (this->sender() == nullptr) return nullptr;
+        snapshots_ = static_cast<Producer<State>*>(this->sender())->snapshots();
+      }
+      return snapshots_.get();
+    }
+
+    /// Copy the newest published state into `state()`.
+    ///
+    /// @return false if there was no newer state
+    bool update_state() noexcept
+    {
+      auto* snapshots = this->snapshots();
+      return snapshots != nullptr && snapshots->read(state_, version_);
+    }
+
+    /// Copy the newest published state into `dst` without changing `state()`, for `set_state`.
+    ///
+    /// @return false if there was no newer state
+    bool read_state(State& dst, std::uint64_t& version) noexcept
+    {
+      version = version_;
+      auto* snapshots = this->snapshots();
+      return snapshots != nullptr && snapshots->read(dst, version);
+    }
+
+    /// Replace `state()` with a state copied by `read_state`
+    void set_state(const State& state, std::uint64_t version) noexcept
+    {
+      state_ = state;
+      version_ = version;
+    }
+
+    /// Call `on_state_change` with the current state
+    void notify_state_change() noexcept
+    {
+      on_state_change(state_);
+    }
+
+    /// Called on the executor after a new state was published.
+    virtual void state_published() noexcept
+    {
+      if (update_state()) on_state_change(state_);
+    }
+
   private:
-    /// Called from {@ref TypedChannelLeaf::internal_commit}
+    /// Called on the executor of this consumer after a commit.
+    ///
+    /// Copies the newest published state. If it was already copied, because of a
+    /// later commit that was received earlier, there is nothing to do.
     void receive(Action e) noexcept override
     {
-      // {
-      //   std::scoped_lock l(lock_);
-      //   tmp_state_ = e.state;
-      // }
-      // executor()->execute([this] {
-      //   // Apply changes
-      //   {
-      //     std::scoped_lock l(lock_);
-      //     state_ = tmp_state_;
-      //   }
-      //   on_state_change(state_);
-      // });
-      // TODO: Proper implementation
-      state_ = std::move(e.state);
-      on_state_change(state_);
+      if (e.snapshots != snapshots_) {
+        // Linked to a new producer
+        snapshots_ = std::move(e.snapshots);
+        version_ = 0;
+      }
+      state_published();
     }
 
-    // util::spin_lock lock_;
     State state_;
-    // State tmp_state_;
+    std::shared_ptr<SnapshotBuffer<State>> snapshots_;
+    /// The version of `state_` in `snapshots_`
+    std::uint64_t version_ = 0;
   };
 
+  namespace detail {
+    /// Forwards the notifications of one state to a consumer of several states
+    template<typename Derived, AState State>
+    struct ConsumerPart : Consumer<State> {
+      using Consumer<State>::Consumer;
+
+    private:
+      void state_published() noexcept final
+      {
+        static_cast<Derived*>(this)->update_states();
+      }
+    };
+  } // namespace detail
+
   template<AState... States>
-  struct Consumer : Consumer<States>... {
-    Consumer(Channel& channels) : Consumer<States>(channels)... {}
+  struct Consumer : detail::ConsumerPart<Consumer<States...>, States>... {
+    Consumer(Channel& channels) : detail::ConsumerPart<Consumer, States>(channels)... {}
 
     template<util::one_of<States...> S>
     const S& state() const noexcept
     {
       return Consumer<S>::state();
     }
+
+  private:
+    template<typename, AState>
+    friend struct detail::ConsumerPart;
+
+    /// Update all states at once when any of them is published, so a transaction
+    /// that changed several of them is never seen half done.
+    ///
+    /// The states are read into `staged_`, and only kept if no transaction published any of them
+    /// in the meantime. Otherwise the previous states are kept. Such a transaction notifies this
+    /// consumer when it is done, so this is called again then, and never has to wait for it.
+    void update_states() noexcept
+    {
+      const auto seq_before = transaction_seqs();
+      if (std::ranges::any_of(seq_before, [](std::uint64_t seq) { return seq % 2 != 0; })) return;
+      std::array<bool, sizeof...(States)> changed = {};
+      std::array<std::uint64_t, sizeof...(States)> versions = {};
+      std::size_t i = 0;
+      ((changed[i] = Consumer<States>::read_state(std::get<States>(staged_), versions[i]), i++), ...);
+      if (transaction_seqs() != seq_before) return;
+      i = 0;
+      ((changed[i] ? Consumer<States>::set_state(std::get<States>(staged_), versions[i]) : void(), i++), ...);
+      i = 0;
+      ((changed[i++] ? Consumer<States>::notify_state_change() : void()), ...);
+    }
+
+    /// The `SnapshotBuffer::transaction_seq` of each of the states
+    std::array<std::uint64_t, sizeof...(States)> transaction_seqs() noexcept
+    {
+      const auto seq = [](auto* snapshots) -> std::uint64_t {
+        return snapshots != nullptr ? snapshots->transaction_seq() : 0;
+      };
+      return {seq(Consumer<States>::snapshots())...};
+    }
+
+    /// Where the states are read before it is known whether they are consistent
+    std::tuple<States...> staged_;
   };
 
 } // namespace otto::itc
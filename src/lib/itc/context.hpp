@@ -1,13 +1,19 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <functional>
 #include <memory>
-#include <unordered_map>
+#include <string>
+#include <string_view>
 #include <vector>
 
+#include "lib/logging.hpp"
 #include "lib/util/concepts.hpp"
 #include "lib/util/exception.hpp"
 #include "lib/util/name_of.hpp"
 #include "lib/util/ranges.hpp"
+#include "lib/util/binary_serialization.hpp"
 #include "lib/util/serialization.hpp"
 
 #include "service.hpp"
@@ -34,8 +40,32 @@ namespace otto::itc {
     }
   };
 
+  /// Integer id of a service type, see `util::type_id`
+  using ServiceId = std::uint64_t;
+
   /// A context tree where providers and accessors of any service can be created and accessed
+  ///
+  /// Providers, accessors and children are kept in vectors sorted by their key, so lookups
+  /// are binary searches over contiguous memory, and services are keyed by integer ids
+  /// computed at compile time.
   struct Context {
+    struct ProviderEntry {
+      ServiceId id;
+      util::string_ref name;
+      detail::ProviderBase* provider;
+    };
+
+    struct AccessorEntry {
+      ServiceId id;
+      util::string_ref name;
+      detail::AccessorBase* accessor;
+    };
+
+    struct ChildEntry {
+      std::string name;
+      std::unique_ptr<Context> context;
+    };
+
     Context() = default;
     ~Context() = default;
 
@@ -46,27 +76,24 @@ namespace otto::itc {
     Context& operator=(const Context&) = delete;
 
     /// Access or create a nested channel group by name
+    ///
+    /// Only allocates when the child is created.
     Context& operator[](std::string_view sv)
     {
-      // Apparently transparent keys don't work in gcc for string_view/string
-      // TODO: Look into that ^
-      auto found = children_.find(std::string(sv));
-      if (found == children_.end()) {
-        auto [iter, inserted] = children_.emplace(sv, std::make_unique<Context>());
-        iter->second->parent_ = this;
-        found = iter;
+      auto found = std::ranges::lower_bound(children_, sv, std::less<>(), &ChildEntry::name);
+      if (found == children_.end() || found->name != sv) {
+        found = children_.insert(found, ChildEntry{std::string(sv), std::make_unique<Context>()});
+        found->context->parent_ = this;
       }
-      return *found->second;
+      return *found->context;
     }
 
     /// Walk up the tree to find the nearest provider of a service
     template<AService S>
     provider_t<S>* find_provider()
     {
-      auto res = provider_of<S>();
-      if (res != nullptr) return res;
-      if (parent_ != nullptr) {
-        return parent_->find_provider<S>();
+      for (Context* ctx = this; ctx != nullptr; ctx = ctx->parent_) {
+        if (auto* res = ctx->provider_of<S>()) return res;
       }
       return nullptr;
     }
@@ -75,15 +102,18 @@ namespace otto::itc {
     {
       return parent_;
     }
-    const auto& children() const noexcept
+    /// The children, sorted by name
+    const std::vector<ChildEntry>& children() const noexcept
     {
       return children_;
     }
-    const auto& providers() const noexcept
+    /// The providers, sorted by service id
+    const std::vector<ProviderEntry>& providers() const noexcept
     {
       return providers_;
     }
-    const auto& accessors() const noexcept
+    /// The accessors, sorted by service id
+    const std::vector<AccessorEntry>& accessors() const noexcept
     {
       return accessors_;
     }
@@ -91,9 +121,13 @@ namespace otto::itc {
     template<AService S>
     provider_t<S>* provider_of() const noexcept
     {
-      auto found = providers_.find(key_of<S>());
-      if (found != providers_.end()) {
-        return static_cast<provider_t<S>*>(found->second);
+      auto found = std::ranges::lower_bound(providers_, key_of<S>(), std::less<>(), &ProviderEntry::id);
+      if (found != providers_.end() && found->id == key_of<S>()) {
+        // Collisions between contexts are only found here, entries of one context are checked when added
+        OTTO_ASSERT(found->name == util::qualified_name_of<S>, "Service id collision between {} and {}", found->name,
+                    util::qualified_name_of<S>);
+        if (found->name != util::qualified_name_of<S>) return nullptr;
+        return static_cast<provider_t<S>*>(found->provider);
       }
       return nullptr;
     }
@@ -101,7 +135,7 @@ namespace otto::itc {
     template<AService S>
     auto accessors_of() const noexcept
     {
-      return util::equal_range(accessors_, key_of<S>());
+      return std::ranges::equal_range(accessors_, key_of<S>(), std::less<>(), &AccessorEntry::id);
     }
 
   private:
@@ -111,28 +145,52 @@ namespace otto::itc {
     friend struct Accessor;
 
     template<AService S>
-    static constexpr util::string_ref key_of() noexcept
+    static constexpr ServiceId key_of() noexcept
     {
-      return util::qualified_name_of<S>;
+      return util::type_id<S>;
+    }
+
+    /// Ids are hashes of the type names, so two services may share one.
+    ///
+    /// Called whenever a provider or accessor is added, since either can be the first of its id.
+    ///
+    /// @throws util::exception if a provider or accessor of this context has the id of `S`, but another type
+    template<AService S>
+    void check_id_collision() const
+    {
+      const auto check = [](util::string_ref existing) {
+        if (existing != util::qualified_name_of<S>) {
+          throw util::exception("Service id collision between {} and {}", existing, util::qualified_name_of<S>);
+        }
+      };
+      auto found = std::ranges::lower_bound(providers_, key_of<S>(), std::less<>(), &ProviderEntry::id);
+      if (found != providers_.end() && found->id == key_of<S>()) check(found->name);
+      auto accessors = accessors_of<S>();
+      if (!accessors.empty()) check(accessors.front().name);
     }
 
     /// Called from Provider constructor
     template<AService S>
     void register_provider(Provider<S>* provider)
     {
-      auto [iter, inserted] = providers_.emplace(key_of<S>(), provider);
-      if (!inserted) {
-        throw util::exception("Existing provider found for event {}", key_of<S>());
+      check_id_collision<S>();
+      auto found = std::ranges::lower_bound(providers_, key_of<S>(), std::less<>(), &ProviderEntry::id);
+      if (found != providers_.end() && found->id == key_of<S>()) {
+        throw util::exception("Existing provider found for event {}", util::qualified_name_of<S>);
       }
+      providers_.insert(found, ProviderEntry{key_of<S>(), util::qualified_name_of<S>, provider});
       register_provider_recurse(provider);
     }
     template<AService S>
     void register_provider_recurse(Provider<S>* provider)
     {
-      for (auto [k, r] : util::equal_range(accessors_, key_of<S>())) {
-        linker::link(*provider, *static_cast<Accessor<S>*>(r));
+      for (const AccessorEntry& entry : accessors_of<S>()) {
+        OTTO_ASSERT(entry.name == util::qualified_name_of<S>, "Service id collision between {} and {}", entry.name,
+                    util::qualified_name_of<S>);
+        if (entry.name != util::qualified_name_of<S>) break;
+        linker::link(*provider, *static_cast<Accessor<S>*>(entry.accessor));
       }
-      for (auto&& [k, child] : children_) {
+      for (auto&& [name, child] : children_) {
         child->register_provider_recurse(provider);
       }
     }
@@ -140,8 +198,8 @@ namespace otto::itc {
     template<AService S>
     void unregister_provider(Provider<S>* provider)
     {
-      auto found = std::ranges::find(providers_, provider, [](auto& pair) { return pair.second; });
-      providers_.erase(found);
+      auto found = std::ranges::find(providers_, provider, &ProviderEntry::provider);
+      if (found != providers_.end()) providers_.erase(found);
       for (Accessor<S>* r : provider->accessors()) {
         linker::unlink(*provider, *r);
       }
@@ -150,7 +208,10 @@ namespace otto::itc {
     template<AService S>
     void register_accessor(Accessor<S>* accessor)
     {
-      accessors_.emplace(key_of<S>(), accessor);
+      check_id_collision<S>();
+      // Insert after the existing accessors of the service, to keep them in registration order
+      auto pos = std::ranges::upper_bound(accessors_, key_of<S>(), std::less<>(), &AccessorEntry::id);
+      accessors_.insert(pos, AccessorEntry{key_of<S>(), util::qualified_name_of<S>, accessor});
       auto* s = find_provider<S>();
       if (s) linker::link(*s, *accessor);
     }
@@ -158,8 +219,8 @@ namespace otto::itc {
     template<AService S>
     void unregister_accessor(Accessor<S>* accessor)
     {
-      auto accessors = util::equal_range(accessors_, key_of<S>());
-      auto found = std::ranges::find(accessors, accessor, [](auto& pair) { return pair.second; });
+      auto accessors = accessors_of<S>();
+      auto found = std::ranges::find(accessors, accessor, &AccessorEntry::accessor);
       if (found != accessors.end()) accessors_.erase(found);
       if (accessor->provider()) {
         linker::unlink(*accessor->provider(), *accessor);
@@ -167,9 +228,9 @@ namespace otto::itc {
     }
 
     Context* parent_ = nullptr;
-    std::unordered_map<std::string, std::unique_ptr<Context>> children_;
-    std::unordered_map<util::string_ref, detail::ProviderBase*> providers_;
-    std::unordered_multimap<util::string_ref, detail::AccessorBase*> accessors_;
+    std::vector<ChildEntry> children_;
+    std::vector<ProviderEntry> providers_;
+    std::vector<AccessorEntry> accessors_;
   };
 
 } // namespace otto::itc
@@ -180,9 +241,9 @@ namespace otto::util {
   struct serialize_impl<itc::Context> {
     static void serialize_into(json::value& json, const itc::Context& ctx)
     {
-      for (auto&& [key, prov] : ctx.providers()) {
-        if (const auto* ser = dynamic_cast<util::ISerializable*>(prov)) {
-          util::serialize_into(json[key.c_str()], *ser);
+      for (const auto& entry : ctx.providers()) {
+        if (const auto* ser = dynamic_cast<util::ISerializable*>(entry.provider)) {
+          util::serialize_into(json[entry.name.c_str()], *ser);
         }
       }
       for (auto&& [k, v] : ctx.children()) {
@@ -192,9 +253,9 @@ namespace otto::util {
 
     static void deserialize_from(const json::value& json, itc::Context& ctx)
     {
-      for (auto&& [key, prov] : ctx.providers()) {
-        if (auto* ser = dynamic_cast<util::ISerializable*>(prov)) {
-          util::deserialize_from_member(json, key.c_str(), *ser);
+      for (const auto& entry : ctx.providers()) {
+        if (auto* ser = dynamic_cast<util::ISerializable*>(entry.provider)) {
+          util::deserialize_from_member(json, entry.name.c_str(), *ser);
         }
       }
       for (auto&& [k, v] : ctx.children()) {
@@ -203,4 +264,57 @@ namespace otto::util {
     }
   };
 
+  /// Binary snapshots of a context.
+  ///
+  /// Each provider is written with its service id and size, and each child with its name and size,
+  /// so providers and children that do not exist when reading are skipped.
+  template<>
+  struct binary_impl<itc::Context> {
+    static void serialize_into(BinaryWriter& out, const itc::Context& ctx)
+    {
+      const auto binary = [](const itc::Context::ProviderEntry& entry) {
+        return dynamic_cast<const util::IBinarySerializable*>(entry.provider);
+      };
+      out.write(static_cast<std::uint32_t>(std::ranges::count_if(ctx.providers(), binary)));
+      for (const auto& entry : ctx.providers()) {
+        if (const auto* ser = binary(entry)) {
+          out.write(entry.id);
+          const auto pos = out.begin_size();
+          ser->serialize_into(out);
+          out.end_size(pos);
+        }
+      }
+      out.write(static_cast<std::uint32_t>(ctx.children().size()));
+      for (const auto& [name, child] : ctx.children()) {
+        util::serialize_into(out, name);
+        const auto pos = out.begin_size();
+        serialize_into(out, *child);
+        out.end_size(pos);
+      }
+    }
+
+    static void deserialize_from(BinaryReader& in, itc::Context& ctx)
+    {
+      const auto provider_count = in.read<std::uint32_t>();
+      for (std::uint32_t i = 0; i < provider_count; i++) {
+        const auto id = in.read<itc::ServiceId>();
+        auto data = in.sized();
+        const auto& providers = ctx.providers();
+        auto found = std::ranges::lower_bound(providers, id, std::less<>(), &itc::Context::ProviderEntry::id);
+        if (found == providers.end() || found->id != id) continue;
+        if (auto* ser = dynamic_cast<util::IBinarySerializable*>(found->provider)) ser->deserialize_from(data);
+      }
+      const auto child_count = in.read<std::uint32_t>();
+      std::string name;
+      for (std::uint32_t i = 0; i < child_count; i++) {
+        util::deserialize_from(in, name);
+        auto data = in.sized();
+        const auto& children = ctx.children();
+        auto found = std::ranges::lower_bound(children, name, std::less<>(), &itc::Context::ChildEntry::name);
+        if (found == children.end() || found->name != name) continue;
+        deserialize_from(data, *found->context);
+      }
+    }
+  };
+
 } // namespace otto::util
@@ -1,5 +1,9 @@
 #include "executor.hpp"
 
+#include <algorithm>
+#include <bit>
+#include <tuple>
+
 #include <yamc_semaphore.hpp>
 
 #include "lib/logging.hpp"
@@ -20,35 +24,222 @@ namespace otto::itc {
 
   // QueueExecutor
 
+  namespace {
+    template<typename Timer>
+    bool later(const Timer& a, const Timer& b) noexcept
+    {
+      return std::tie(a.time, a.seq) > std::tie(b.time, b.seq);
+    }
+  } // namespace
+
+  QueueExecutor::QueueExecutor(std::size_t capacity) : lanes_{{Ring(capacity), Ring(capacity)}}
+  {
+    timers_.reserve(default_timer_capacity);
+  }
+
   void QueueExecutor::execute(Function f) noexcept
   {
-    queue_.enqueue(std::move(f));
-    notify();
+    execute(std::move(f), Priority::normal);
+  }
+
+  void QueueExecutor::execute(Function f, Priority p) noexcept
+  {
+    if (try_execute(f, p)) return;
+    overflows_.fetch_add(1, std::memory_order_relaxed);
+    OTTO_ASSERT(false, "QueueExecutor is full, a function was dropped");
+  }
+
+  bool QueueExecutor::try_execute(Function& f, Priority p) noexcept
+  {
+    if (!lane(p).try_enqueue(f)) return false;
+    wake();
+    return true;
+  }
+
+  void QueueExecutor::execute_at(chrono::time_point time, Function f)
+  {
+    {
+      std::scoped_lock l(timer_mutex_);
+      timers_.push_back(Timer{time, timer_seq_++, std::move(f)});
+      std::ranges::push_heap(timers_, later<Timer>);
+      next_timer_.store(timers_.front().time.time_since_epoch().count(), std::memory_order_release);
+    }
+    // The waiting thread may have to wake up earlier now
+    wake();
   }
+
+  bool QueueExecutor::try_dequeue(Function& f) noexcept
+  {
+    return std::ranges::any_of(lanes_, [&](Ring& r) { return r.try_dequeue(f); });
+  }
+
+  chrono::time_point QueueExecutor::next_timer() const noexcept
+  {
+    return chrono::time_point(chrono::duration(next_timer_.load(std::memory_order_acquire)));
+  }
+
+  bool QueueExecutor::try_pop_due_timer(Function& f, chrono::time_point now) noexcept
+  {
+    if (next_timer() > now) return false;
+    // Never wait for the lock, this may be the audio thread
+    std::unique_lock lock(timer_mutex_, std::try_to_lock);
+    if (!lock || timers_.empty() || timers_.front().time > now) return false;
+    std::ranges::pop_heap(timers_, later<Timer>);
+    f = std::move(timers_.back().function);
+    timers_.pop_back();
+    const auto next = timers_.empty() ? chrono::time_point::max() : timers_.front().time;
+    next_timer_.store(next.time_since_epoch().count(), std::memory_order_release);
+    return true;
+  }
+
   bool QueueExecutor::run_queued_functions() noexcept
   {
     bool res = false;
     Function f;
-    while (queue_.try_dequeue(f)) {
+    if (next_timer() != chrono::time_point::max()) {
+      const auto now = chrono::clock::now();
+      while (try_pop_due_timer(f, now)) {
+        f();
+        f.reset();
+        res = true;
+      }
+    }
+    while (try_dequeue(f)) {
       f();
+      f.reset();
       res = true;
     }
     return res;
   }
+
+  std::size_t QueueExecutor::run_queued_functions(chrono::duration budget, std::size_t max_functions) noexcept
+  {
+    auto now = chrono::clock::now();
+    const auto deadline = now + budget;
+    std::size_t count = 0;
+    Function f;
+    while (count < max_functions && (count == 0 || now < deadline) &&
+           (try_pop_due_timer(f, now) || try_dequeue(f))) {
+      f();
+      f.reset();
+      count++;
+      now = chrono::clock::now();
+    }
+    return count;
+  }
+
   bool QueueExecutor::has_queued() noexcept
   {
-    return queue_.size_approx() > 0;
+    return std::ranges::any_of(lanes_, [](const Ring& r) { return !r.empty(); });
   }
 
   void QueueExecutor::notify() noexcept
   {
-    cond_.notify_all();
+    notified_.store(true, std::memory_order_relaxed);
+    wake();
+  }
+
+  void QueueExecutor::wake() noexcept
+  {
+    // Pairs with the fence in block_until, so either the producer sees the
+    // consumer sleeping, or the consumer sees the function, timer or notification.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_relaxed) && sleeping_.exchange(false, std::memory_order_acq_rel)) {
+      wakeup_.release();
+    }
   }
 
   void QueueExecutor::run_queued_functions_blocking(std::chrono::system_clock::duration timeout) noexcept
   {
-    std::unique_lock lock(mutex_);
-    cond_.wait_for(lock, timeout, [this] { return run_queued_functions(); });
+    const auto now = chrono::clock::now();
+    block_until(timeout < chrono::time_point::max() - now ? now + timeout : chrono::time_point::max());
+  }
+
+  void QueueExecutor::run_queued_functions_blocking() noexcept
+  {
+    block_until(chrono::time_point::max());
+  }
+
+  void QueueExecutor::block_until(chrono::time_point deadline) noexcept
+  {
+    if (run_queued_functions()) return;
+    sleeping_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool woken = false;
+    if (!notified_.exchange(false, std::memory_order_relaxed) && !has_queued()) {
+      const auto wake_at = std::min(deadline, next_timer());
+      if (wake_at == chrono::time_point::max()) {
+        wakeup_.acquire();
+        woken = true;
+      } else {
+        woken = wakeup_.try_acquire_until(wake_at);
+      }
+    }
+    if (!woken) {
+      // Not woken by a producer. If one cleared the flag in the meantime, it has
+      // released or is about to release the semaphore, which has to be consumed.
+      if (!sleeping_.exchange(false, std::memory_order_acq_rel)) wakeup_.acquire();
+    }
+    run_queued_functions();
+  }
+
+  // QueueExecutor::Ring
+
+  QueueExecutor::Ring::Ring(std::size_t capacity)
+    : slots_(std::make_unique<Slot[]>(std::bit_ceil(std::max<std::size_t>(capacity, 2)))),
+      mask_(std::bit_ceil(std::max<std::size_t>(capacity, 2)) - 1)
+  {
+    for (std::size_t i = 0; i <= mask_; i++) {
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  bool QueueExecutor::Ring::empty() const noexcept
+  {
+    return enqueue_pos_.load(std::memory_order_relaxed) == dequeue_pos_.load(std::memory_order_relaxed);
+  }
+
+  bool QueueExecutor::Ring::try_enqueue(Function& f) noexcept
+  {
+    std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      Slot& slot = slots_[pos & mask_];
+      const std::size_t seq = slot.sequence.load(std::memory_order_acquire);
+      const auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          slot.function = std::move(f);
+          slot.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        // The slot still holds the function from one lap ago
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool QueueExecutor::Ring::try_dequeue(Function& f) noexcept
+  {
+    std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      Slot& slot = slots_[pos & mask_];
+      const std::size_t seq = slot.sequence.load(std::memory_order_acquire);
+      const auto diff = static_cast<std::ptrdiff_t>(seq - (pos + 1));
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          f = std::move(slot.function);
+          slot.sequence.store(pos + mask_ + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
   }
 
 } // namespace otto::itc
@@ -1,87 +1,265 @@
 #pragma once
 
-#include <condition_variable>
+#include <array>
+#include <atomic>
 #include <functional>
+#include <memory>
 #include <mutex>
+#include <semaphore>
+#include <thread>
 #include <vector>
 
-#include <concurrentqueue.h>
-#include <function2/function2.hpp>
-
+#include "lib/chrono.hpp"
+#include "lib/util/inline_function.hpp"
 #include "lib/util/utility.hpp"
 
 namespace otto::itc {
 
+  /// Functions of higher priority are run before functions of lower priority,
+  /// by executors that support it.
+  enum struct Priority {
+    /// Transport, notes and other events that are audible when late
+    high,
+    /// State changes and everything else
+    normal,
+  };
+
   struct IExecutor {
     virtual ~IExecutor() = default;
-    using Function = fu2::unique_function<void()>;
 
-    // TODO: Allocator for the std::function object
+    /// The maximum size of the captures of an executed function.
+    ///
+    /// Enough for a state change action of any of the engines.
+    static constexpr std::size_t function_capacity = 256;
+    /// Functions are stored inline, so executing one never allocates.
+    /// Functions with larger captures fail to compile.
+    using Function = util::inline_function<void(), function_capacity>;
+
     /// Execute a function on this executor
     ///
     /// Most likely adds it to some queue or calls it directly.
     /// Guarantees:
     /// - Functions will be executed exactly once
-    /// - Functions will be executed in order
+    /// - Functions of the same priority will be executed in order
     virtual void execute(Function) = 0;
 
+    /// Execute a function with the given priority.
+    ///
+    /// Executors without priorities execute it like any other function.
+    virtual void execute(Function f, Priority)
+    {
+      execute(std::move(f));
+    }
+
+    /// Execute a function once `time` has passed
+    ///
+    /// Functions due at the same time are executed in the order they were added.
+    virtual void execute_at(chrono::time_point time, Function f) = 0;
+
+    /// Execute a function once `delay` has passed
+    void execute_after(chrono::duration delay, Function f)
+    {
+      execute_at(chrono::clock::now() + delay, std::move(f));
+    }
+
     /// Wait for all functions queued before this one to be executed
     void sync() noexcept;
   };
 
   /// An executor that immediately calls the function
   struct ImmediateExecutor final : IExecutor {
+    using IExecutor::execute;
     void execute(Function f) override
     {
       std::move(f)();
     }
+
+    /// Blocks until `time`, then calls the function
+    void execute_at(chrono::time_point time, Function f) override
+    {
+      std::this_thread::sleep_until(time);
+      std::move(f)();
+    }
   };
 
   /// An executor that enqueues functions on a concurrent queue
   ///
   /// Can be used with multiple producing and multiple consuming threads.
   ///
+  /// Each priority has its own bounded ring of function slots, allocated up front,
+  /// so neither `execute` nor `run_queued_functions` allocate. High priority
+  /// functions are run before normal ones.
+  ///
+  /// Timed functions are kept in a min-heap, and run by `run_queued_functions` once due,
+  /// before the queued functions. `run_queued_functions_blocking` sleeps until the next
+  /// timed function is due, so the consuming thread needs no periodic wakeups.
+  ///
   /// @NOTE Requires synchronization upon destruction. The last call to
   /// {@ref run_queued_functions} _must_ be started strictly _after_ the last
   /// call to {@ref execute} to ensure that the function will indeed be called.
   /// This is nowhere near as trivial as it sounds!
   struct QueueExecutor final : IExecutor {
+    static constexpr std::size_t default_capacity = 512;
+    /// The number of timed functions that fit without allocating
+    static constexpr std::size_t default_timer_capacity = 64;
+
+    /// @param capacity The number of functions each priority can hold. Rounded up to a power of two.
+    explicit QueueExecutor(std::size_t capacity = default_capacity);
+
     ~QueueExecutor() noexcept
     {
       notify();
     }
-    /// Enqueue a function
+
+    QueueExecutor(const QueueExecutor&) = delete;
+    QueueExecutor& operator=(const QueueExecutor&) = delete;
+
+    /// Enqueue a function with normal priority
     ///
     /// Can be called from any thread. Functions queued from one thread
     /// will be executed in order, but not necessarily in order with
     /// functions enqueued from other threads.
+    ///
+    /// If the queue is full, the function is dropped and counted in `overflows()`.
+    /// This never waits for a consumer, which may be the calling thread. Asserts in debug builds,
+    /// use `try_execute` where a full queue is expected.
+    ///
+    /// Wakes up a thread in `run_queued_functions_blocking` without locks,
+    /// so it is safe to call from the audio thread.
     void execute(Function) noexcept override;
 
-    /// Run functions from the queue until none are available
+    /// Enqueue a function with the given priority
+    ///
+    /// Functions of different priorities are not executed in order.
+    void execute(Function, Priority) noexcept override;
+
+    /// Enqueue a function, unless the queue of its priority is full.
+    ///
+    /// @return false if the queue was full. `f` is left untouched then, so it can be retried.
+    [[nodiscard]] bool try_execute(Function& f, Priority p = Priority::normal) noexcept;
+
+    /// The number of functions `execute` dropped because the queue was full
+    [[nodiscard]] std::size_t overflows() const noexcept
+    {
+      return overflows_.load(std::memory_order_relaxed);
+    }
+
+    /// Run a function once `time` has passed.
+    ///
+    /// Can be called from any thread, but takes a lock, and allocates if more than
+    /// `default_timer_capacity` timed functions are pending. Prefer `execute` on the audio thread.
+    void execute_at(chrono::time_point time, Function f) override;
+
+    /// Run due timed functions, and functions from the queue until none are available
+    ///
+    /// Due timed functions are skipped if another thread holds the timer lock.
     ///
     /// @return true if any functions were run
     bool run_queued_functions() noexcept;
 
+    /// Run functions from the queue, highest priority first, until none are
+    /// available, `budget` has passed, or `max_functions` have been run.
+    ///
+    /// The clock is checked before each function, so one slow function can still overrun
+    /// the budget. At least one function is run if any are queued, so the queue makes progress
+    /// even when there is no time left.
+    ///
+    /// @return the number of functions run
+    std::size_t run_queued_functions(chrono::duration budget, std::size_t max_functions) noexcept;
+
     /// Run functions from the queue until none are available.
     ///
-    /// If none are available initially, block and wait for `notify()`
-    /// or `execute` to be called.
+    /// If none are available initially, block and wait for `notify()`, `execute`,
+    /// the next timed function, or the timeout.
+    ///
+    /// Only one thread may wait on an executor at a time.
     void run_queued_functions_blocking(std::chrono::system_clock::duration timeout) noexcept;
 
+    /// Like `run_queued_functions_blocking(timeout)`, without the timeout
+    void run_queued_functions_blocking() noexcept;
+
     /// Check if the queue contains any functions.
     ///
     /// If this returns true, `run_queued_functions` will have functions to run
     /// If it returns false, you learned basically nothing.
     bool has_queued() noexcept;
 
+    /// The number of functions each priority can hold
+    [[nodiscard]] std::size_t capacity() const noexcept
+    {
+      return lanes_[0].capacity();
+    }
 
     /// Wake up the thread waiting on `run_queued_functions_blocking`
+    ///
+    /// If no thread is waiting, the next call returns without waiting.
     void notify() noexcept;
 
   private:
-    moodycamel::ConcurrentQueue<Function> queue_;
-    std::condition_variable cond_;
-    std::mutex mutex_;
+    /// A bounded MPMC ring of functions, as in Dmitry Vyukov's bounded queue.
+    struct Ring {
+      explicit Ring(std::size_t capacity);
+
+      bool try_enqueue(Function& f) noexcept;
+      bool try_dequeue(Function& f) noexcept;
+      [[nodiscard]] bool empty() const noexcept;
+
+      [[nodiscard]] std::size_t capacity() const noexcept
+      {
+        return mask_ + 1;
+      }
+
+    private:
+      /// `sequence` tells producers and consumers whose turn the slot is
+      struct Slot {
+        std::atomic<std::size_t> sequence;
+        Function function;
+      };
+
+      std::unique_ptr<Slot[]> slots_;
+      std::size_t mask_ = 0;
+      alignas(64) std::atomic<std::size_t> enqueue_pos_ = 0;
+      alignas(64) std::atomic<std::size_t> dequeue_pos_ = 0;
+    };
+
+    static constexpr std::size_t priority_count = 2;
+
+    Ring& lane(Priority p) noexcept
+    {
+      return lanes_[static_cast<std::size_t>(p)];
+    }
+
+    struct Timer {
+      chrono::time_point time;
+      /// Orders timers due at the same time
+      std::uint64_t seq;
+      Function function;
+    };
+
+    bool try_dequeue(Function& f) noexcept;
+    /// Pop the first timer if it is due
+    bool try_pop_due_timer(Function& f, chrono::time_point now) noexcept;
+    /// The time of the first timer, or `time_point::max()`
+    [[nodiscard]] chrono::time_point next_timer() const noexcept;
+    /// Wake up a waiting thread, if any
+    void wake() noexcept;
+    void block_until(chrono::time_point deadline) noexcept;
+
+    std::array<Ring, priority_count> lanes_;
+    std::atomic<std::size_t> overflows_ = 0;
+
+    std::mutex timer_mutex_;
+    /// Min-heap on `(time, seq)`
+    std::vector<Timer> timers_;
+    std::uint64_t timer_seq_ = 0;
+    /// The time of the first timer, readable without the lock
+    std::atomic<chrono::duration::rep> next_timer_ = chrono::duration::max().count();
+    /// Set by `notify`, consumed by the next blocking wait
+    std::atomic<bool> notified_ = false;
+
+    /// Set by a consumer before it blocks. A producer that clears it releases `wakeup_`.
+    std::atomic<bool> sleeping_ = false;
+    std::binary_semaphore wakeup_{0};
   };
 
 } // namespace otto::itc
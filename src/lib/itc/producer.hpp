@@ -2,20 +2,62 @@
 
 #include "sender.hpp"
 #include "state.hpp"
+#include "transaction.hpp"
 
 namespace otto::itc {
 
+  /// Counts the commits of a producer, to find the states that changed since some point
+  struct IVersioned {
+    virtual ~IVersioned() = default;
+    /// Incremented when a commit is published.
+    ///
+    /// Always 0 for states that are not saved with the app, so they are never seen as changed.
+    [[nodiscard]] virtual std::uint64_t version() const noexcept = 0;
+  };
+
+  /// States that are saved with the app, which are json serializable.
+  ///
+  /// Only these are read and written by binary snapshots of a context. The other states, like the
+  /// ones published by the audio engines, are only committed by the thread that owns them.
+  template<typename State>
+  concept APersistentState = util::ASerializable<State> && util::ABinarySerializable<State>;
+
   template<AState State>
-  struct Producer<State> : Sender<state_change_action<State>>, util::ISerializable {
+  struct Producer<State> : Sender<state_change_action<State>>,
+                           util::ISerializable,
+                           util::IBinarySerializable,
+                           IVersioned,
+                           private detail::ITransactionMember {
     using Action = state_change_action<State>;
     Producer(Channel& channels) : Sender<Action>(channels) {}
 
     /// Commit the current `state()`, notifying consumers
+    ///
+    /// The state is copied once, into a snapshot shared by all consumers.
+    /// In a {@ref Transaction}, this is deferred until the transaction ends.
     void commit()
     {
-      // TODO: Do not send state along as action
-      Sender<Action>::send(Action{state()});
-      on_state_change(state());
+      if (Transaction::active()) {
+        Transaction::defer(*this);
+        return;
+      }
+      publish_pending();
+      notify_pending();
+    }
+
+    /// The snapshots of the committed state
+    [[nodiscard]] const std::shared_ptr<SnapshotBuffer<State>>& snapshots() const noexcept
+    {
+      return snapshots_;
+    }
+
+    [[nodiscard]] std::uint64_t version() const noexcept override
+    {
+      if constexpr (APersistentState<State>) {
+        return snapshots_->version();
+      } else {
+        return 0;
+      }
     }
 
     State& state() noexcept
@@ -70,10 +112,50 @@ namespace otto::itc {
       }
     }
 
+    /// Write the state to a binary snapshot, if it is an `APersistentState`
+    void serialize_into(util::BinaryWriter& out) const override
+    {
+      if constexpr (APersistentState<State>) {
+        util::serialize_into(out, state_);
+      }
+    }
+    /// Read the state from a binary snapshot, and commit it, if it is an `APersistentState`.
+    ///
+    /// In a {@ref Transaction}, consumers see all states read in it change together.
+    void deserialize_from(util::BinaryReader& in) override
+    {
+      if constexpr (APersistentState<State>) {
+        util::deserialize_from(in, state_);
+        commit();
+      }
+    }
+
     virtual void on_state_change(const State&) {}
 
   private:
+    void begin_transaction() noexcept override
+    {
+      snapshots_->begin_transaction();
+    }
+
+    void end_transaction() noexcept override
+    {
+      snapshots_->end_transaction();
+    }
+
+    void publish_pending() noexcept override
+    {
+      snapshots_->publish(state_);
+    }
+
+    void notify_pending() noexcept override
+    {
+      Sender<Action>::send(Action{snapshots_});
+      on_state_change(state_);
+    }
+
     State state_;
+    std::shared_ptr<SnapshotBuffer<State>> snapshots_ = std::make_shared<SnapshotBuffer<State>>();
   };
 
   template<AState... States>
@@ -95,9 +177,12 @@ namespace otto::itc {
     }
 
     /// Commit the current states of the given types, notifying all consumers
+    ///
+    /// The states are committed in one transaction, so consumers see them change together.
     template<util::one_of<States...>... S>
     void commit() noexcept
     {
+      Transaction t;
       (Producer<S>::commit(), ...);
     }
 
@@ -3,9 +3,23 @@
 #include "accessor.hpp"
 #include "action.hpp"
 #include "channel.hpp"
+#include "snapshot.hpp"
 
 namespace otto::itc {
 
+  namespace detail {
+    /// Holds the newest pending action of a coalescing action type
+    template<AnAction Action>
+    struct Mailbox {
+      /// Written by the sender, read on the executor of the receiver
+      SnapshotBuffer<Action, 1> action;
+      std::uint64_t version = 0;
+      /// Whether a function that empties the mailbox is queued on the executor
+      std::atomic<bool> pending = false;
+    };
+    struct NoMailbox {};
+  } // namespace detail
+
   template<AnAction Action>
   struct Receiver<Action> : private virtual IDomain, Accessor<action_service<Action>> {
     Receiver(Channel& ch) : Accessor<action_service<Action>>(ch) {}
@@ -38,10 +52,26 @@ namespace otto::itc {
     void internal_send(const Action& action) noexcept
     {
       if (exec_ == nullptr) exec_ = &executor();
-      exec_->execute([this, action] { receive(std::move(action)); });
+      if constexpr (action_coalesces<Action>) {
+        mailbox_.action.publish(action);
+        // The executor function clears the flag before it reads the mailbox,
+        // so an action published after that read queues a new function.
+        if (mailbox_.pending.exchange(true, std::memory_order_seq_cst)) return;
+        exec_->execute(
+          [this] {
+            mailbox_.pending.store(false, std::memory_order_seq_cst);
+            Action a;
+            if (mailbox_.action.read(a, mailbox_.version)) receive(std::move(a));
+          },
+          action_priority<Action>);
+      } else {
+        exec_->execute([this, action] { receive(std::move(action)); }, action_priority<Action>);
+      }
     }
 
     IExecutor* exec_ = nullptr;
+    [[no_unique_address]] std::conditional_t<action_coalesces<Action>, detail::Mailbox<Action>, detail::NoMailbox>
+      mailbox_;
   };
 
   template<AnAction... Actions>
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <concepts>
+#include <cstdint>
+#include <thread>
+
+namespace otto::itc {
+
+  /// Lock-free publishing of versioned snapshots of a value, from one writer to many readers.
+  ///
+  /// The writer copies each new value into a free slot and makes it the latest version.
+  /// Readers pin the latest slot while copying out of it, so the writer never overwrites
+  /// a slot that is being read. Readers only copy versions they have not seen yet.
+  ///
+  /// There are enough slots for `MaxReaders` threads reading at the same time. With more
+  /// concurrent readers, `publish` may have to wait for one of them to finish.
+  template<std::semiregular T, std::size_t MaxReaders = 4>
+  struct SnapshotBuffer {
+    static constexpr std::size_t slot_count = MaxReaders + 2;
+
+    /// Publish a new version of the value. Must only be called from one thread at a time.
+    void publish(const T& value) noexcept
+    {
+      const std::uint64_t latest = latest_.load(std::memory_order_relaxed);
+      const std::size_t idx = free_slot(latest & index_mask);
+      slots_[idx].value = value;
+      latest_.store((((latest >> index_bits) + 1) << index_bits) | idx, std::memory_order_seq_cst);
+    }
+
+    /// Copy the latest value into `dst` if it is newer than `version`, and update `version`.
+    ///
+    /// Version 0 is never published, so pass 0 to read any published value.
+    ///
+    /// @return true if a value was copied
+    bool read(T& dst, std::uint64_t& version) noexcept
+    {
+      while (true) {
+        const std::uint64_t latest = latest_.load(std::memory_order_seq_cst);
+        if ((latest >> index_bits) == version) return false;
+        Slot& slot = slots_[latest & index_mask];
+        slot.readers.fetch_add(1, std::memory_order_seq_cst);
+        // The writer may have reused the slot between the two loads. If the version
+        // is unchanged, it was not, and it will not be until the slot is released.
+        if (latest_.load(std::memory_order_seq_cst) != latest) {
+          slot.readers.fetch_sub(1, std::memory_order_release);
+          continue;
+        }
+        dst = slot.value;
+        slot.readers.fetch_sub(1, std::memory_order_release);
+        version = latest >> index_bits;
+        return true;
+      }
+    }
+
+    /// The latest published version, or 0 if nothing has been published
+    [[nodiscard]] std::uint64_t version() const noexcept
+    {
+      return latest_.load(std::memory_order_acquire) >> index_bits;
+    }
+
+    /// Mark the start of a transaction that publishes this value together with others.
+    ///
+    /// Called by the writer. `transaction_seq` is odd until `end_transaction`.
+    void begin_transaction() noexcept
+    {
+      transaction_seq_.fetch_add(1, std::memory_order_seq_cst);
+    }
+
+    /// Mark the end of a transaction started with `begin_transaction`
+    void end_transaction() noexcept
+    {
+      transaction_seq_.fetch_add(1, std::memory_order_seq_cst);
+    }
+
+    /// Changes with every transaction this value is part of, and is odd while one is being published.
+    ///
+    /// Readers of several values compare it before and after reading, to know that they did not
+    /// read some of the values of a transaction without the others.
+    [[nodiscard]] std::uint64_t transaction_seq() const noexcept
+    {
+      return transaction_seq_.load(std::memory_order_seq_cst);
+    }
+
+  private:
+    static constexpr std::uint64_t index_bits = 8;
+    static constexpr std::uint64_t index_mask = (1 << index_bits) - 1;
+    static_assert(slot_count <= index_mask);
+
+    struct Slot {
+      std::atomic<std::uint32_t> readers = 0;
+      T value = {};
+    };
+
+    /// Find a slot that is neither the latest nor being read
+    std::size_t free_slot(std::size_t latest_idx) noexcept
+    {
+      while (true) {
+        for (std::size_t i = 0; i < slot_count; i++) {
+          if (i != latest_idx && slots_[i].readers.load(std::memory_order_seq_cst) == 0) return i;
+        }
+        std::this_thread::yield();
+      }
+    }
+
+    std::array<Slot, slot_count> slots_;
+    /// The version in the upper bits, and the index of its slot in the lower `index_bits`
+    std::atomic<std::uint64_t> latest_ = 0;
+    std::atomic<std::uint64_t> transaction_seq_ = 0;
+  };
+
+} // namespace otto::itc
@@ -1,8 +1,10 @@
 #pragma once
 
 #include <concepts>
+#include <memory>
 
 #include "lib/itc/action.hpp"
+#include "lib/itc/snapshot.hpp"
 
 namespace otto::itc {
 
@@ -20,13 +22,20 @@ namespace otto::itc {
   template<AState... States>
   struct Consumer;
 
+  /// Tells a consumer that a new version of the state was published.
+  ///
+  /// The state itself is not part of the action. Consumers read the newest
+  /// version from the snapshots of the producer when they handle it.
   template<AState State_>
   struct state_change_action {
     using State = State_;
-    // TODO: Obviously dont copy the entire state
-    State state;
+    std::shared_ptr<SnapshotBuffer<State>> snapshots;
   };
 
+  /// Only the newest state matters, so consumers skip the intermediate ones
+  template<AState State>
+  constexpr bool action_coalesces<state_change_action<State>> = true;
+
   template<typename T>
   concept AStateEvent = std::is_same_v<T, state_change_action<typename T::State>>;
 
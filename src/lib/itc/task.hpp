@@ -0,0 +1,321 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <semaphore>
+#include <utility>
+#include <variant>
+
+#include "lib/itc/executor.hpp"
+#include "lib/logging.hpp"
+
+namespace otto::itc {
+
+  /// Awaitable that resumes the awaiting coroutine on an executor.
+  ///
+  /// This is how a coroutine moves between threads:
+  /// ```cpp
+  /// co_await audio.executor();
+  /// // Now on the audio thread
+  /// co_await logic.executor();
+  /// // Back on the logic thread
+  /// ```
+  /// Awaiting the executor the coroutine is already on works like `sync()`, without blocking.
+  struct ResumeOn {
+    IExecutor& executor;
+    Priority priority = Priority::normal;
+
+    [[nodiscard]] bool await_ready() const noexcept
+    {
+      return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> h)
+    {
+      executor.execute([h] { h.resume(); }, priority);
+    }
+
+    void await_resume() const noexcept {}
+  };
+
+  inline ResumeOn operator co_await(IExecutor& e) noexcept
+  {
+    return {e};
+  }
+
+  /// Resume on `e`, with the given priority
+  inline ResumeOn resume_on(IExecutor& e, Priority p) noexcept
+  {
+    return {e, p};
+  }
+
+  /// Awaitable that resumes the awaiting coroutine on an executor once `time` has passed.
+  struct ResumeAt {
+    IExecutor& executor;
+    chrono::time_point time;
+
+    [[nodiscard]] bool await_ready() const noexcept
+    {
+      return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> h)
+    {
+      executor.execute_at(time, [h] { h.resume(); });
+    }
+
+    void await_resume() const noexcept {}
+  };
+
+  /// Resume on `e` once `delay` has passed, without blocking any thread in the meantime
+  inline ResumeAt resume_after(IExecutor& e, chrono::duration delay) noexcept
+  {
+    return {e, chrono::clock::now() + delay};
+  }
+
+  template<typename T = void>
+  struct Task;
+
+  namespace detail {
+    /// Storage for the result of a task, or the exception it exited with
+    template<typename T>
+    struct TaskResult {
+      template<typename U>
+      void return_value(U&& v) noexcept(std::is_nothrow_constructible_v<T, U>)
+      {
+        result_.template emplace<1>(std::forward<U>(v));
+      }
+
+      void unhandled_exception() noexcept
+      {
+        result_.template emplace<2>(std::current_exception());
+      }
+
+      T result()
+      {
+        if (result_.index() == 2) std::rethrow_exception(std::get<2>(result_));
+        return std::move(std::get<1>(result_));
+      }
+
+      [[nodiscard]] bool has_exception() const noexcept
+      {
+        return result_.index() == 2;
+      }
+
+    private:
+      std::variant<std::monostate, T, std::exception_ptr> result_;
+    };
+
+    template<>
+    struct TaskResult<void> {
+      void return_void() noexcept {}
+
+      void unhandled_exception() noexcept
+      {
+        exception_ = std::current_exception();
+      }
+
+      void result()
+      {
+        if (exception_) std::rethrow_exception(exception_);
+      }
+
+      [[nodiscard]] bool has_exception() const noexcept
+      {
+        return exception_ != nullptr;
+      }
+
+    private:
+      std::exception_ptr exception_;
+    };
+
+    /// Coroutine that signals a semaphore when it is done, used by `sync_wait`
+    struct SyncWaiter {
+      struct promise_type {
+        std::binary_semaphore* done = nullptr;
+
+        SyncWaiter get_return_object() noexcept
+        {
+          return {std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        std::suspend_always initial_suspend() noexcept
+        {
+          return {};
+        }
+
+        auto final_suspend() noexcept
+        {
+          struct Awaiter {
+            [[nodiscard]] bool await_ready() const noexcept
+            {
+              return false;
+            }
+            void await_suspend(std::coroutine_handle<promise_type> h) noexcept
+            {
+              // The frame is destroyed by the waiting thread, so this is the last use of it
+              h.promise().done->release();
+            }
+            void await_resume() const noexcept {}
+          };
+          return Awaiter{};
+        }
+
+        void return_void() noexcept {}
+
+        void unhandled_exception() noexcept
+        {
+          // The exceptions of the awaited task are stored in the task
+          std::terminate();
+        }
+      };
+
+      std::coroutine_handle<promise_type> handle;
+    };
+  } // namespace detail
+
+  /// A lazily started coroutine, which produces a `T`.
+  ///
+  /// The coroutine starts when the task is awaited, and the awaiting coroutine continues
+  /// when it is done, on the thread it finished on. Use `co_await executor` to hop between
+  /// threads, so multi-step flows across domains run without parking any thread:
+  /// ```cpp
+  /// itc::Task<> load_preset(Preset p)
+  /// {
+  ///   co_await logic.executor();
+  ///   auto state = deserialize(p);
+  ///   co_await audio.executor();
+  ///   apply(state);
+  ///   co_await graphics.executor();
+  ///   redraw();
+  /// }
+  /// ```
+  ///
+  /// Exceptions thrown in the coroutine are rethrown to the awaiter.
+  template<typename T>
+  struct [[nodiscard]] Task {
+    struct promise_type : detail::TaskResult<T> {
+      Task get_return_object() noexcept
+      {
+        return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+      }
+
+      std::suspend_always initial_suspend() noexcept
+      {
+        return {};
+      }
+
+      auto final_suspend() noexcept
+      {
+        struct Awaiter {
+          [[nodiscard]] bool await_ready() const noexcept
+          {
+            return false;
+          }
+          std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept
+          {
+            auto& p = h.promise();
+            if (p.detached) {
+              OTTO_ASSERT(!p.has_exception(), "A detached task exited with an exception");
+              h.destroy();
+              return std::noop_coroutine();
+            }
+            return p.continuation ? p.continuation : std::noop_coroutine();
+          }
+          void await_resume() const noexcept {}
+        };
+        return Awaiter{};
+      }
+
+      std::coroutine_handle<> continuation;
+      bool detached = false;
+    };
+
+    Task(Task&& rhs) noexcept : handle_(std::exchange(rhs.handle_, nullptr)) {}
+
+    Task& operator=(Task&& rhs) noexcept
+    {
+      if (this != &rhs) {
+        if (handle_) handle_.destroy();
+        handle_ = std::exchange(rhs.handle_, nullptr);
+      }
+      return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() noexcept
+    {
+      if (handle_) handle_.destroy();
+    }
+
+    /// Start the task, and await its result
+    auto operator co_await() && noexcept
+    {
+      OTTO_ASSERT(static_cast<bool>(handle_), "Awaiting an empty task");
+      return Awaiter{handle_};
+    }
+
+    /// Start the task without waiting for it. It is destroyed when it is done.
+    ///
+    /// The task must not exit with an exception.
+    void detach() &&
+    {
+      auto h = std::exchange(handle_, nullptr);
+      h.promise().detached = true;
+      h.resume();
+    }
+
+    /// Start the task and block the calling thread until it is done.
+    ///
+    /// This parks the thread, like `IExecutor::sync`, so only use it at the boundary
+    /// between blocking and asynchronous code. The task must not need the calling thread
+    /// to finish, i.e. it must not await the executor of the calling thread.
+    T sync_wait() &&
+    {
+      std::binary_semaphore done{0};
+      auto waiter = [](Task& t) -> detail::SyncWaiter {
+        co_await std::move(t).completion();
+      }(*this);
+      waiter.handle.promise().done = &done;
+      waiter.handle.resume();
+      done.acquire();
+      waiter.handle.destroy();
+      return handle_.promise().result();
+    }
+
+  private:
+    explicit Task(std::coroutine_handle<promise_type> h) noexcept : handle_(h) {}
+
+    struct Awaiter {
+      std::coroutine_handle<promise_type> handle;
+
+      [[nodiscard]] bool await_ready() const noexcept
+      {
+        return false;
+      }
+      std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) noexcept
+      {
+        handle.promise().continuation = continuation;
+        return handle;
+      }
+      T await_resume()
+      {
+        return handle.promise().result();
+      }
+    };
+
+    /// Like `co_await`, leaving the result in the task
+    auto completion() && noexcept
+    {
+      struct Completion : Awaiter {
+        void await_resume() const noexcept {}
+      };
+      return Completion{{handle_}};
+    }
+
+    std::coroutine_handle<promise_type> handle_;
+  };
+
+} // namespace otto::itc
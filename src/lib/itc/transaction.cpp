@@ -0,0 +1,52 @@
+#include "transaction.hpp"
+
+#include <algorithm>
+
+#include "lib/logging.hpp"
+#include "lib/util/local_vector.hpp"
+
+namespace otto::itc {
+
+  namespace {
+    using Members = util::local_vector<detail::ITransactionMember*, Transaction::max_members>;
+    thread_local int depth = 0;        // NOLINT
+    thread_local Members pending = {}; // NOLINT
+  } // namespace
+
+  Transaction::Transaction() noexcept
+  {
+    depth++;
+  }
+
+  Transaction::~Transaction() noexcept
+  {
+    if (--depth > 0) return;
+    if (pending.empty()) return;
+    // Consumers notified below may commit again, so work on a copy
+    const Members members = pending;
+    pending.clear();
+    for (auto* m : members) m->begin_transaction();
+    for (auto* m : members) m->publish_pending();
+    for (auto* m : members) m->end_transaction();
+    for (auto* m : members) m->notify_pending();
+  }
+
+  bool Transaction::active() noexcept
+  {
+    return depth > 0;
+  }
+
+  void Transaction::defer(detail::ITransactionMember& member) noexcept
+  {
+    if (std::ranges::find(pending, &member) != pending.end()) return;
+    if (pending.full()) {
+      OTTO_ASSERT(false, "More than {} producers committed in one transaction", max_members);
+      // Publish it on its own rather than allocate
+      member.publish_pending();
+      member.notify_pending();
+      return;
+    }
+    pending.push_back(&member);
+  }
+
+} // namespace otto::itc
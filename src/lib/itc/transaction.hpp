@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+
+namespace otto::itc {
+
+  namespace detail {
+    /// A producer with changes that are published when the transaction ends
+    struct ITransactionMember {
+      virtual ~ITransactionMember() = default;
+      /// Mark the snapshots as being published by a transaction, see `SnapshotBuffer::transaction_seq`
+      virtual void begin_transaction() noexcept = 0;
+      /// Mark the end of `begin_transaction`
+      virtual void end_transaction() noexcept = 0;
+      /// Publish the state to the snapshots read by consumers
+      virtual void publish_pending() noexcept = 0;
+      /// Notify the consumers of the published state
+      virtual void notify_pending() noexcept = 0;
+    };
+  } // namespace detail
+
+  /// Groups the commits on this thread into one atomic update.
+  ///
+  /// While a transaction is open, `Producer::commit` only marks the state as changed.
+  /// When the outermost transaction on the thread ends, all changed states are published
+  /// together, and then each consumer is notified once per state. Consumers of several of
+  /// the states never see some of them changed without the others.
+  ///
+  /// Producers committed in a transaction must outlive it, and at most `max_members`
+  /// producers can be committed in one transaction.
+  ///
+  /// ```cpp
+  /// {
+  ///   itc::Transaction t;
+  ///   for (auto e : events) reducer.handle(e);
+  /// } // Published here
+  /// ```
+  struct Transaction {
+    Transaction() noexcept;
+    ~Transaction() noexcept;
+
+    /// The number of producers one transaction can hold. Deferring never allocates.
+    static constexpr std::size_t max_members = 64;
+
+    Transaction(const Transaction&) = delete;
+    Transaction& operator=(const Transaction&) = delete;
+
+    /// Whether a transaction is open on the calling thread
+    [[nodiscard]] static bool active() noexcept;
+
+    /// Publish `member` when the transaction ends. Called by `Producer::commit`.
+    static void defer(detail::ITransactionMember& member) noexcept;
+  };
+
+} // namespace otto::itc
@@ -2,19 +2,83 @@
 
 #include <fstream>
 
+#include "lib/util/mapped_file.hpp"
+
 namespace otto::json {
 
+  namespace {
+    /// Json text always starts with whitespace, a comment or a value. Binary documents are
+    /// maps or arrays, which start with bytes outside of the printable range.
+    bool looks_like_json(std::span<const std::uint8_t> data) noexcept
+    {
+      if (data.empty()) return true;
+      switch (data[0]) {
+        case ' ':
+        case '\t':
+        case '\r':
+        case '\n':
+        case '/':
+        case '{':
+        case '[':
+        case '"': return true;
+        default: return false;
+      }
+    }
+  } // namespace
+
+  Format format_of(const std::filesystem::path& path) noexcept
+  {
+    const auto ext = path.extension();
+    if (ext == ".cbor") return Format::cbor;
+    if (ext == ".msgpack") return Format::msgpack;
+    return Format::json;
+  }
+
+  value parse(std::span<const std::uint8_t> data, Format format)
+  {
+    switch (format) {
+      case Format::cbor: return value::from_cbor(data.begin(), data.end());
+      case Format::msgpack: return value::from_msgpack(data.begin(), data.end());
+      case Format::json: break;
+    }
+    return value::parse(data.begin(), data.end(), nullptr, true, true);
+  }
+
+  std::vector<std::uint8_t> dump(const value& v, Format format)
+  {
+    switch (format) {
+      case Format::cbor: return value::to_cbor(v);
+      case Format::msgpack: return value::to_msgpack(v);
+      case Format::json: break;
+    }
+    const auto text = v.dump();
+    return {text.begin(), text.end()};
+  }
+
+  std::filesystem::path find_file(const std::filesystem::path& path)
+  {
+    if (std::filesystem::exists(path)) return path;
+    auto json_path = path;
+    json_path.replace_extension(".json");
+    if (std::filesystem::exists(json_path)) return json_path;
+    return path;
+  }
+
   value parse_file(const std::filesystem::path& path)
   {
-    std::ifstream f(path);
-    return value::parse(f, nullptr, true, true);
+    const auto found = find_file(path);
+    util::MappedFile file(found);
+    const auto bytes = file.bytes();
+    const std::span data(reinterpret_cast<const std::uint8_t*>(bytes.data()), bytes.size());
+    return parse(data, looks_like_json(data) ? Format::json : format_of(found));
   }
 
   void write_to_file(const value& v, const std::filesystem::path& path)
   {
+    const auto data = dump(v, format_of(path));
     std::ofstream file;
-    file.open(path);
-    file << v;
+    file.open(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
     file.close();
   }
 
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <cstdint>
 #include <filesystem>
+#include <span>
+#include <vector>
 
 #include <nlohmann/json.hpp>
 
@@ -21,6 +24,36 @@ namespace otto::json {
     j = t;
   };
 
+  /// The encoding of a file
+  enum struct Format {
+    json,
+    cbor,
+    msgpack,
+  };
+
+  /// The format of a file from its extension. `.cbor` and `.msgpack` are binary, everything else is json.
+  [[nodiscard]] Format format_of(const std::filesystem::path& path) noexcept;
+
+  /// Parse `data` as `format`. Json may contain comments.
+  ///
+  /// @throws json::value::parse_error
+  [[nodiscard]] value parse(std::span<const std::uint8_t> data, Format format);
+
+  /// Encode `v` as `format`
+  [[nodiscard]] std::vector<std::uint8_t> dump(const value& v, Format format);
+
+  /// The file to read for `path`: `path` itself if it exists, or else the same path with
+  /// a `.json` extension if that exists. This reads files written before their format was changed.
+  [[nodiscard]] std::filesystem::path find_file(const std::filesystem::path& path);
+
+  /// Parse the file found by `find_file(path)`.
+  ///
+  /// The file is memory mapped and parsed in place. If it starts like json text it is parsed as
+  /// json, otherwise in the format of its extension.
+  ///
+  /// @throws std::system_error if the file can not be read, json::value::parse_error if it can not be parsed
   value parse_file(const std::filesystem::path& path);
+
+  /// Write `v` to `path`, in the format of its extension
   void write_to_file(const value& v, const std::filesystem::path& path);
 } // namespace otto::json
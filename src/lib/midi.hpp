@@ -134,6 +134,13 @@ namespace otto::midi {
 
   using MidiEvent = std::variant<NoteOn, NoteOff, Aftertouch, PolyAftertouch, PitchBend>;
 
+  /// A midi event scheduled inside an audio block
+  struct TimedMidiEvent {
+    MidiEvent event;
+    /// Offset in frames from the start of the audio block
+    std::size_t frame = 0;
+  };
+
   using IMidiHandler = IEventHandler<NoteOn, NoteOff, Aftertouch, PolyAftertouch, PitchBend>;
 
   struct MidiHandler : IMidiHandler {
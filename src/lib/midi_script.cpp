@@ -0,0 +1,97 @@
+#include "midi_script.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+#include <tl/optional.hpp>
+
+namespace otto::midi {
+
+  namespace {
+    /// Parse a number in the range [0, max]
+    int parse_number(const std::string& word, std::size_t line_no, int max)
+    {
+      int res = 0;
+      try {
+        std::size_t pos = 0;
+        res = std::stoi(word, &pos);
+        if (pos != word.size()) throw std::invalid_argument(word);
+      } catch (std::logic_error&) {
+        throw util::exception("Line {}: invalid argument '{}'", line_no, word);
+      }
+      if (res < 0 || res > max) {
+        throw util::exception("Line {}: argument {} out of range [0, {}]", line_no, res, max);
+      }
+      return res;
+    }
+  } // namespace
+
+  MidiScript MidiScript::parse(std::istream& input)
+  {
+    MidiScript res;
+    tl::optional<double> end;
+    std::string text;
+    for (std::size_t line_no = 1; std::getline(input, text); line_no++) {
+      std::istringstream line(text.substr(0, text.find('#')));
+      double time = 0;
+      std::string name;
+      if (!(line >> time)) {
+        if (line.eof()) continue;
+        throw util::exception("Line {}: expected a time in seconds", line_no);
+      }
+      if (time < 0) throw util::exception("Line {}: negative time", line_no);
+      if (!(line >> name)) throw util::exception("Line {}: expected an event", line_no);
+
+      std::vector<std::string> args;
+      for (std::string word; line >> word;) args.push_back(word);
+      std::uint8_t channel = 0;
+      if (!args.empty() && args.back().starts_with("ch=")) {
+        channel = static_cast<std::uint8_t>(parse_number(args.back().substr(3), line_no, 15));
+        args.pop_back();
+      }
+      const auto arg = [&](std::size_t i, int max, tl::optional<int> fallback = tl::nullopt) {
+        if (i < args.size()) return parse_number(args[i], line_no, max);
+        if (fallback) return *fallback;
+        throw util::exception("Line {}: missing argument to '{}'", line_no, name);
+      };
+      const auto expect_args = [&](std::size_t n) {
+        if (args.size() > n) throw util::exception("Line {}: too many arguments to '{}'", line_no, name);
+      };
+
+      MidiEvent event;
+      if (name == "end") {
+        expect_args(0);
+        end = time;
+        continue;
+      } else if (name == "note_on") {
+        expect_args(2);
+        const auto note = static_cast<std::uint8_t>(arg(0, 127));
+        const auto velocity = static_cast<std::uint8_t>(arg(1, 127, 100));
+        event = NoteOn{.note = note, .velocity = velocity, .channel = channel};
+      } else if (name == "note_off") {
+        expect_args(2);
+        const auto note = static_cast<std::uint8_t>(arg(0, 127));
+        const auto velocity = static_cast<std::uint8_t>(arg(1, 127, 0));
+        event = NoteOff{.note = note, .velocity = velocity, .channel = channel};
+      } else if (name == "pitch_bend") {
+        expect_args(1);
+        event = PitchBend{.pitch_bend = static_cast<std::uint16_t>(arg(0, (1 << 14) - 1)), .channel = channel};
+      } else if (name == "aftertouch") {
+        expect_args(1);
+        event = Aftertouch{.aftertouch = static_cast<std::uint8_t>(arg(0, 127)), .channel = channel};
+      } else if (name == "poly_aftertouch") {
+        expect_args(2);
+        const auto note = static_cast<std::uint8_t>(arg(0, 127));
+        const auto aftertouch = static_cast<std::uint8_t>(arg(1, 127));
+        event = PolyAftertouch{.note = note, .aftertouch = aftertouch, .channel = channel};
+      } else {
+        throw util::exception("Line {}: unknown event '{}'", line_no, name);
+      }
+      res.events.push_back({.time = time, .event = event});
+    }
+    std::ranges::stable_sort(res.events, std::less<>(), &Entry::time);
+    res.end_time = end.value_or(res.events.empty() ? 0 : res.events.back().time);
+    return res;
+  }
+
+} // namespace otto::midi
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <istream>
+#include <vector>
+
+#include "lib/midi.hpp"
+
+namespace otto::midi {
+
+  /// A list of timed midi events, read from a simple text format.
+  ///
+  /// Each line is a time in seconds, an event name and its arguments.
+  /// Empty lines and everything after a `#` are ignored.
+  ///
+  /// ```
+  /// # time  event            arguments
+  /// 0.0     note_on          60 100     # note, velocity (default 100)
+  /// 0.5     note_off         60
+  /// 0.5     pitch_bend       8192       # 0 - 16383, 8192 is centered
+  /// 0.5     aftertouch       64
+  /// 0.5     poly_aftertouch  60 64      # note, aftertouch
+  /// 2.0     end                         # optional, the length of the script
+  /// ```
+  ///
+  /// The channel can be set with a trailing `ch=<n>` argument.
+  struct MidiScript {
+    struct Entry {
+      double time = 0;
+      MidiEvent event;
+    };
+
+    /// Parse a script
+    ///
+    /// @throws util::exception on invalid lines, with the line number in the message
+    static MidiScript parse(std::istream& input);
+
+    /// The events, sorted by time. Events at the same time keep the order of the script.
+    std::vector<Entry> events;
+    /// The time of the `end` line, or of the last event if there is none
+    double end_time = 0;
+  };
+
+} // namespace otto::midi
@@ -1,5 +1,7 @@
 #include "audio_buffer.hpp"
 
+#include <bit>
+
 #include "lib/logging.hpp"
 
 namespace otto::util {
@@ -9,14 +11,26 @@ namespace otto::util {
     if (ref_count_ != nullptr) (*ref_count_)++;
   }
 
-  audio_buffer::audio_buffer(audio_buffer&& rhs) noexcept : data_(rhs.data_), ref_count_(rhs.ref_count_)
+  audio_buffer::audio_buffer(AudioBufferPool& pool, std::span<float> d) noexcept : data_(d), pool_(&pool) {}
+
+  audio_buffer::audio_buffer(audio_buffer&& rhs) noexcept
+    : data_(rhs.data_), ref_count_(rhs.ref_count_), pool_(rhs.pool_)
   {
     rhs.ref_count_ = nullptr;
+    rhs.pool_ = nullptr;
   }
 
   audio_buffer::~audio_buffer() noexcept
+  {
+    release();
+  }
+
+  void audio_buffer::release() noexcept
   {
     if (ref_count_ != nullptr) (*ref_count_)--;
+    if (pool_ != nullptr) pool_->release(data_.data());
+    ref_count_ = nullptr;
+    pool_ = nullptr;
   }
 
   audio_buffer::iterator audio_buffer::end() noexcept
@@ -45,6 +59,19 @@ namespace otto::util {
     return *this;
   }
 
+  audio_buffer audio_buffer::slice(std::size_t offset, std::size_t length) const noexcept
+  {
+    OTTO_ASSERT(offset + length <= size());
+    return audio_buffer(data_.subspan(offset, length), nullptr);
+  }
+
+  audio_buffer& audio_buffer::truncate(std::size_t length) noexcept
+  {
+    OTTO_ASSERT(length <= size());
+    data_ = data_.first(length);
+    return *this;
+  }
+
   std::size_t audio_buffer::size() const noexcept
   {
     return data_.size();
@@ -79,52 +106,114 @@ namespace otto::util {
 
   audio_buffer& audio_buffer::operator=(audio_buffer&& rhs) noexcept
   {
+    if (this == &rhs) return *this;
+    release();
     data_ = rhs.data_;
     ref_count_ = rhs.ref_count_;
+    pool_ = rhs.pool_;
     rhs.ref_count_ = nullptr;
+    rhs.pool_ = nullptr;
     return *this;
   }
 
   // AudioBufferPool
 
-  AudioBufferPool::AudioBufferPool(std::size_t max_buf_count, std::size_t bufsize) : bufsize_(bufsize)
-  {
-    ref_counts_.resize(max_buf_count);
-    data_.resize(max_buf_count * bufsize_);
+  namespace {
+    constexpr std::size_t word_bits = 64;
+
+    /// Mask of the `n` lowest bits
+    constexpr std::uint64_t low_bits(std::size_t n) noexcept
+    {
+      return n >= word_bits ? ~std::uint64_t{0} : (std::uint64_t{1} << n) - 1;
+    }
+
+    /// Given a mask of free buffers, get a mask with the bits set where a run of `n` free buffers starts
+    constexpr std::uint64_t run_starts(std::uint64_t free, std::size_t n) noexcept
+    {
+      // After each step, bit i is set if the `len` bits from i are all set
+      for (std::size_t len = 1; len < n && free != 0;) {
+        const std::size_t shift = std::min(len, n - len);
+        free &= free >> shift;
+        len += shift;
+      }
+      return free;
+    }
+  } // namespace
+
+  AudioBufferPool::AudioBufferPool(std::size_t max_buf_count, std::size_t bufsize)
+    : bufsize_(bufsize),
+      capacity_(max_buf_count),
+      data_(max_buf_count * bufsize),
+      used_(std::make_unique<std::atomic<std::uint64_t>[]>((max_buf_count + word_bits - 1) / word_bits)),
+      word_count_((max_buf_count + word_bits - 1) / word_bits),
+      lengths_(std::make_unique<std::uint8_t[]>(max_buf_count))
+  {
+    for (std::size_t w = 0; w < word_count_; w++) used_[w].store(0, std::memory_order_relaxed);
+    // Mark the bits past the end of the pool as used
+    if (const auto rem = capacity_ % word_bits; rem != 0) {
+      used_[word_count_ - 1].store(~low_bits(rem), std::memory_order_relaxed);
+    }
   }
 
-  audio_buffer AudioBufferPool::allocate(const std::size_t multiplier) noexcept
+  AudioBufferPool::~AudioBufferPool() noexcept
   {
-    // Find unused buffer
-    int idx = 0;
-    int n_found = 0;
-    int actual_rc = 0;
-    for (const std::int8_t rc : ref_counts_) {
-      if (rc >= 0) actual_rc = static_cast<int>(rc); // NOLINT
-      if (actual_rc == 0) {
-        n_found++;
-        if (n_found == multiplier) break;
-      } else {
-        n_found = 0;
-      }
-      idx++;
+    if (in_use() != 0) {
+      LOGE("AudioBufferPool destroyed with {} buffers still allocated: {}", in_use(), fmt::join(outstanding(), ", "));
     }
-    // TODO: error handling?
-    OTTO_ASSERT(n_found == multiplier);
-
-    auto first_idx = idx - multiplier + 1;
-    ref_counts_[first_idx] = 0;
-    // When multiplier is > 1, refcounts of all but the first used buffer
-    // are set to -1, to indicate
-    for (int i = 1; i < multiplier; i++) {
-      ref_counts_[first_idx + i] = -1;
+  }
+
+  tl::optional<audio_buffer> AudioBufferPool::try_allocate(const std::size_t multiplier) noexcept
+  {
+    OTTO_ASSERT(multiplier > 0 && multiplier <= max_multiplier);
+    for (std::size_t w = 0; w < word_count_; w++) {
+      std::uint64_t used = used_[w].load(std::memory_order_relaxed);
+      while (true) {
+        const std::uint64_t starts = run_starts(~used, multiplier);
+        if (starts == 0) break;
+        const auto bit = static_cast<std::size_t>(std::countr_zero(starts));
+        const std::uint64_t mask = low_bits(multiplier) << bit;
+        if (!used_[w].compare_exchange_weak(used, used | mask, std::memory_order_acquire,
+                                            std::memory_order_relaxed)) {
+          continue;
+        }
+        const std::size_t idx = w * word_bits + bit;
+        lengths_[idx] = static_cast<std::uint8_t>(multiplier);
+        const std::size_t now_used = in_use_.fetch_add(multiplier, std::memory_order_relaxed) + multiplier;
+        std::size_t hwm = high_water_mark_.load(std::memory_order_relaxed);
+        while (now_used > hwm && !high_water_mark_.compare_exchange_weak(hwm, now_used, std::memory_order_relaxed)) {
+        }
+        return audio_buffer(*this, {data_.data() + bufsize_ * idx, bufsize_ * multiplier});
+      }
     }
-    // Clear remaining -1s when using a space that was previously used for a larger buffer
-    for (std::size_t i = first_idx + multiplier; i < ref_counts_.size(); i++) {
-      if (ref_counts_[i] >= 0) break;
-      ref_counts_[i] = 0;
+    failed_allocations_.fetch_add(1, std::memory_order_relaxed);
+    return tl::nullopt;
+  }
+
+  audio_buffer AudioBufferPool::allocate(const std::size_t multiplier) noexcept
+  {
+    auto res = try_allocate(multiplier);
+    OTTO_ASSERT(res.has_value(), "AudioBufferPool is out of buffers");
+    if (!res) return audio_buffer({}, nullptr);
+    return std::move(*res);
+  }
+
+  void AudioBufferPool::release(const float* data) noexcept
+  {
+    const auto idx = static_cast<std::size_t>(data - data_.data()) / bufsize_;
+    OTTO_ASSERT(idx < capacity_);
+    const std::size_t length = lengths_[idx];
+    const std::size_t w = idx / word_bits;
+    used_[w].fetch_and(~(low_bits(length) << (idx % word_bits)), std::memory_order_release);
+    in_use_.fetch_sub(length, std::memory_order_relaxed);
+  }
+
+  std::vector<std::size_t> AudioBufferPool::outstanding() const
+  {
+    std::vector<std::size_t> res;
+    for (std::size_t i = 0; i < capacity_; i++) {
+      if ((used_[i / word_bits].load(std::memory_order_relaxed) >> (i % word_bits)) & 1) res.push_back(i);
     }
-    return audio_buffer({data_.data() + bufsize_ * first_idx, bufsize_ * n_found}, &ref_counts_[first_idx]);
+    return res;
   }
 
   std::span<const float> AudioBufferPool::data() const noexcept
@@ -1,8 +1,13 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <memory>
 #include <ranges>
 #include <span>
+#include <vector>
+
+#include <tl/optional.hpp>
 
 #include "lib/util/ranges.hpp"
 
@@ -10,9 +15,20 @@
 
 namespace otto::util {
 
+  /// How a processor writes to a caller-provided output buffer
+  enum struct MixMode {
+    /// Overwrite the contents of the buffer
+    replace,
+    /// Add to the contents of the buffer
+    accumulate,
+  };
+
+  struct AudioBufferPool;
+
   /// Reference-counting span of floats with deep assignment
   ///
-  /// Designed to work with {@ref AudioBufferPool} for allocation
+  /// Designed to work with {@ref AudioBufferPool} for allocation. Buffers from a pool
+  /// are returned to it on destruction, which may happen on any thread.
   struct audio_buffer {
     using iterator = float*;
     using const_iterator = const float*;
@@ -44,12 +60,26 @@ namespace otto::util {
     /// Fill buffer with zeros
     audio_buffer& clear() noexcept;
 
+    /// A view of `length` samples starting at `offset`.
+    ///
+    /// The view is not reference counted, and must not outlive this buffer.
+    [[nodiscard]] audio_buffer slice(std::size_t offset, std::size_t length) const noexcept;
+
+    /// Shrink the buffer to its first `length` samples, keeping the reference count.
+    audio_buffer& truncate(std::size_t length) noexcept;
+
     float& operator[](std::size_t i) noexcept;
     const float& operator[](std::size_t i) const noexcept;
 
   private:
+    friend AudioBufferPool;
+    /// A buffer owned by `pool`, released to it on destruction
+    audio_buffer(AudioBufferPool& pool, std::span<float> d) noexcept;
+    void release() noexcept;
+
     std::span<float> data_;
-    std::int8_t* ref_count_;
+    std::int8_t* ref_count_ = nullptr;
+    AudioBufferPool* pool_ = nullptr;
   };
 
   static_assert(std::ranges::contiguous_range<audio_buffer>);
@@ -84,6 +114,19 @@ namespace otto::util {
       return std::move(*this);
     }
 
+    /// A view of `length` frames starting at `offset`.
+    ///
+    /// The view is not reference counted, and must not outlive this buffer.
+    [[nodiscard]] stereo_audio_buffer slice(std::size_t offset, std::size_t length) const noexcept
+    {
+      return {left.slice(offset, length), right.slice(offset, length)};
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+      return left.size();
+    }
+
     [[nodiscard]] auto zipped() noexcept
     {
       return util::zip(left, right);
@@ -114,10 +157,33 @@ namespace otto::util {
   };
 
   /// An init-time fixed-size pool to allocate {@ref audio_buffer}s of varying sizes.
+  ///
+  /// Free buffers are tracked in a bitmap of atomic 64 bit words, where allocation is a
+  /// bit search and a compare-and-swap, and release is a single atomic `and`. This makes
+  /// both constant time for pools of up to 64 buffers, and safe to call from any thread.
+  /// Larger buffers are contiguous runs of buffers, which can not cross a 64 buffer boundary.
+  ///
+  /// Buffers must not outlive the pool. The pool can not be moved, since they point to it.
   struct AudioBufferPool {
+    /// The maximum number of buffers in one allocation
+    static constexpr std::size_t max_multiplier = 64;
+
     explicit AudioBufferPool(std::size_t max_buf_count, std::size_t bufsize);
+    /// Logs an error if any buffers are still allocated
+    ~AudioBufferPool() noexcept;
+
+    AudioBufferPool(const AudioBufferPool&) = delete;
+    AudioBufferPool& operator=(const AudioBufferPool&) = delete;
+
+    /// Allocate a buffer of `multiplier` times the buffer size, using the first free space.
+    ///
+    /// @return `tl::nullopt` if there is no room left
+    [[nodiscard]] tl::optional<audio_buffer> try_allocate(std::size_t multiplier = 1) noexcept;
 
     /// Allocate an audio buffer
+    ///
+    /// Running out of buffers is a programming error. It asserts in debug builds, and
+    /// returns an empty buffer otherwise. See `failed_allocations`.
     [[nodiscard]] audio_buffer allocate(std::size_t multiplier = 1) noexcept;
     [[nodiscard]] stereo_audio_buffer allocate_stereo(const std::size_t multiplier = 1) noexcept
     {
@@ -126,10 +192,60 @@ namespace otto::util {
 
     [[nodiscard]] std::span<const float> data() const noexcept;
 
+    /// The number of buffers of the buffer size in the pool
+    [[nodiscard]] std::size_t capacity() const noexcept
+    {
+      return capacity_;
+    }
+
+    /// The number of frames in each buffer
+    [[nodiscard]] std::size_t buffer_size() const noexcept
+    {
+      return bufsize_;
+    }
+
+    /// The number of buffers currently allocated, counting each part of larger buffers
+    [[nodiscard]] std::size_t in_use() const noexcept
+    {
+      return in_use_.load(std::memory_order_relaxed);
+    }
+
+    /// The highest `in_use()` seen since construction or `reset_high_water_mark`
+    [[nodiscard]] std::size_t high_water_mark() const noexcept
+    {
+      return high_water_mark_.load(std::memory_order_relaxed);
+    }
+
+    void reset_high_water_mark() noexcept
+    {
+      high_water_mark_.store(in_use(), std::memory_order_relaxed);
+    }
+
+    /// The number of allocations that failed because the pool was full
+    [[nodiscard]] std::size_t failed_allocations() const noexcept
+    {
+      return failed_allocations_.load(std::memory_order_relaxed);
+    }
+
+    /// The indices of the buffers currently allocated. Useful to find leaks.
+    [[nodiscard]] std::vector<std::size_t> outstanding() const;
+
   private:
+    friend audio_buffer;
+    /// Return the buffer starting at `data` to the pool
+    void release(const float* data) noexcept;
+
     std::size_t bufsize_;
-    std::vector<std::int8_t> ref_counts_;
+    std::size_t capacity_;
     std::vector<float> data_;
+    /// One bit per buffer, set when allocated
+    std::unique_ptr<std::atomic<std::uint64_t>[]> used_;
+    std::size_t word_count_;
+    /// The number of buffers in the allocation starting at each buffer
+    std::unique_ptr<std::uint8_t[]> lengths_;
+    std::atomic<std::size_t> in_use_ = 0;
+    std::atomic<std::size_t> high_water_mark_ = 0;
+    std::atomic<std::size_t> failed_allocations_ = 0;
   };
 
 } // namespace otto::util
@@ -0,0 +1,222 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "lib/util/exception.hpp"
+#include "lib/util/serialization.hpp"
+#include "lib/util/visitor.hpp"
+
+namespace otto::util {
+
+  /// Appends binary data to a byte buffer.
+  ///
+  /// Clearing and reusing the buffer keeps its capacity, so writing a snapshot of
+  /// the same size again does not allocate.
+  struct BinaryWriter {
+    explicit BinaryWriter(std::vector<std::byte>& buffer) noexcept : buffer_(buffer) {}
+
+    void write(const void* data, std::size_t size)
+    {
+      const auto* bytes = static_cast<const std::byte*>(data);
+      buffer_.insert(buffer_.end(), bytes, bytes + size);
+    }
+
+    template<typename T>
+    requires std::is_trivially_copyable_v<T>
+    void write(const T& value)
+    {
+      write(&value, sizeof(T));
+    }
+
+    /// Reserve room for a size, which is filled in by `end_size`
+    [[nodiscard]] std::size_t begin_size()
+    {
+      const std::size_t pos = buffer_.size();
+      write(std::uint32_t{0});
+      return pos;
+    }
+
+    /// Fill in the number of bytes written since `begin_size` returned `pos`
+    void end_size(std::size_t pos) noexcept
+    {
+      const auto size = static_cast<std::uint32_t>(buffer_.size() - pos - sizeof(std::uint32_t));
+      std::memcpy(buffer_.data() + pos, &size, sizeof(size));
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+      return buffer_.size();
+    }
+
+  private:
+    std::vector<std::byte>& buffer_;
+  };
+
+  /// Reads binary data written by a `BinaryWriter`
+  struct BinaryReader {
+    explicit BinaryReader(std::span<const std::byte> data) noexcept : data_(data) {}
+
+    /// @throws util::exception if there is not enough data left
+    void read(void* dst, std::size_t size)
+    {
+      if (size > remaining()) {
+        throw util::exception("Binary snapshot ended early, reading {} bytes with {} left", size, remaining());
+      }
+      std::memcpy(dst, data_.data() + pos_, size);
+      pos_ += size;
+    }
+
+    template<typename T>
+    requires std::is_trivially_copyable_v<T> T read()
+    {
+      T res;
+      read(&res, sizeof(T));
+      return res;
+    }
+
+    /// Read a size written with `BinaryWriter::begin_size`, and return a reader for the bytes it covers
+    BinaryReader sized()
+    {
+      const auto size = read<std::uint32_t>();
+      if (size > remaining()) {
+        throw util::exception("Binary snapshot ended early, reading {} bytes with {} left", size, remaining());
+      }
+      BinaryReader res(data_.subspan(pos_, size));
+      pos_ += size;
+      return res;
+    }
+
+    [[nodiscard]] std::size_t remaining() const noexcept
+    {
+      return data_.size() - pos_;
+    }
+
+  private:
+    std::span<const std::byte> data_;
+    std::size_t pos_ = 0;
+  };
+
+  /// Used to implement binary serialization for types that the generic rules do not cover,
+  /// or should not be covered by them.
+  ///
+  /// Specialize this, and implement
+  /// ```cpp
+  /// static void serialize_into(BinaryWriter& out, const T& value);
+  /// static void deserialize_from(BinaryReader& in, T& value);
+  /// ```
+  template<typename T>
+  struct binary_impl;
+
+  template<typename T>
+  concept ACustomBinarySerializable = requires(BinaryWriter& w, BinaryReader& r, T& t)
+  {
+    binary_impl<std::decay_t<T>>::serialize_into(w, t);
+    binary_impl<std::decay_t<T>>::deserialize_from(r, t);
+  };
+
+  namespace detail {
+    template<typename T>
+    concept resizable_range = requires(T& t)
+    {
+      t.resize(std::size_t{});
+      t.begin();
+      t.end();
+    };
+
+    template<typename T>
+    concept fixed_range = requires(T& t)
+    {
+      std::tuple_size<T>::value;
+      t.begin();
+      t.end();
+    };
+  } // namespace detail
+
+  /// Types that can be written by `serialize_into(BinaryWriter&, const T&)`
+  template<typename T>
+  concept ABinarySerializable = ACustomBinarySerializable<T> || std::is_trivially_copyable_v<T> || AVisitable<T> ||
+                                detail::fixed_range<T> || detail::resizable_range<T> || ASerializable<T>;
+
+  /// Serialize `value` into a compact binary snapshot.
+  ///
+  /// The format follows the memory layout of the values, so it is only meant for snapshots
+  /// that are read back by the same build, like the sound slots. Use the json serialization
+  /// for anything that is stored. The first rule that matches is used:
+  ///  - A specialization of `binary_impl`
+  ///  - Trivially copyable types are copied as they are
+  ///  - Types with `DECL_VISIT` are written member by member
+  ///  - Arrays, vectors and strings are written element by element
+  ///  - Other json serializable types are written as CBOR
+  template<typename T>
+  void serialize_into(BinaryWriter& out, const T& value)
+  {
+    if constexpr (ACustomBinarySerializable<T>) {
+      binary_impl<T>::serialize_into(out, value);
+    } else if constexpr (std::is_trivially_copyable_v<T>) {
+      out.write(value);
+    } else if constexpr (AVisitable<const T&>) {
+      util::visit(value, [&](util::string_ref, const auto& member) { util::serialize_into(out, member); });
+    } else if constexpr (detail::fixed_range<T>) {
+      for (const auto& v : value) util::serialize_into(out, v);
+    } else if constexpr (detail::resizable_range<T>) {
+      out.write(static_cast<std::uint32_t>(value.size()));
+      for (const auto& v : value) util::serialize_into(out, v);
+    } else {
+      static_assert(ASerializable<T>, "Type can not be serialized to binary");
+      const auto cbor = json::value::to_cbor(util::serialize(value));
+      out.write(static_cast<std::uint32_t>(cbor.size()));
+      out.write(cbor.data(), cbor.size());
+    }
+  }
+
+  /// Deserialize a value written by `serialize_into(BinaryWriter&, const T&)`.
+  ///
+  /// @throws util::exception if the data ends early
+  template<typename T>
+  void deserialize_from(BinaryReader& in, T& value)
+  {
+    if constexpr (ACustomBinarySerializable<T>) {
+      binary_impl<T>::deserialize_from(in, value);
+    } else if constexpr (std::is_trivially_copyable_v<T>) {
+      in.read(&value, sizeof(T));
+    } else if constexpr (AVisitable<T&>) {
+      util::visit(value, [&](util::string_ref, auto& member) { util::deserialize_from(in, member); });
+    } else if constexpr (detail::fixed_range<T>) {
+      for (auto& v : value) util::deserialize_from(in, v);
+    } else if constexpr (detail::resizable_range<T>) {
+      value.resize(in.read<std::uint32_t>());
+      for (auto& v : value) util::deserialize_from(in, v);
+    } else {
+      static_assert(ASerializable<T>, "Type can not be deserialized from binary");
+      std::vector<std::uint8_t> cbor(in.read<std::uint32_t>());
+      in.read(cbor.data(), cbor.size());
+      util::deserialize_from(json::value::from_cbor(cbor), value);
+    }
+  }
+
+  /// Base class with pure virtual binary serialize/deserialize functions
+  struct IBinarySerializable {
+    virtual ~IBinarySerializable() = default;
+    virtual void serialize_into(BinaryWriter& out) const = 0;
+    virtual void deserialize_from(BinaryReader& in) = 0;
+  };
+
+  template<std::derived_from<IBinarySerializable> T>
+  struct binary_impl<T> {
+    static void serialize_into(BinaryWriter& out, const T& value)
+    {
+      value.serialize_into(out);
+    }
+    static void deserialize_from(BinaryReader& in, T& value)
+    {
+      value.deserialize_from(in);
+    }
+  };
+
+} // namespace otto::util
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace otto::util {
+
+  template<typename Signature, std::size_t Capacity>
+  struct inline_function;
+
+  /// A move-only, type-erased function that stores its callable inline, and never allocates.
+  ///
+  /// Works like `fu2::unique_function`, except that callables larger than `Capacity`
+  /// bytes are rejected at compile time instead of being moved to the heap.
+  template<typename R, typename... Args, std::size_t Capacity>
+  struct inline_function<R(Args...), Capacity> {
+    static constexpr std::size_t capacity = Capacity;
+
+    inline_function() noexcept = default;
+    inline_function(std::nullptr_t) noexcept {} // NOLINT
+
+    template<typename F>
+    requires(!std::is_same_v<std::decay_t<F>, inline_function> && std::is_invocable_r_v<R, std::decay_t<F>&, Args...>)
+    inline_function(F&& f) noexcept(std::is_nothrow_constructible_v<std::decay_t<F>, F>) // NOLINT
+    {
+      using Fn = std::decay_t<F>;
+      static_assert(sizeof(Fn) <= Capacity,
+                    "The callable is too large for this inline_function. Capture less, e.g. by pointer, "
+                    "or increase the capacity");
+      static_assert(alignof(Fn) <= alignof(std::max_align_t), "The callable is over-aligned for inline_function");
+      static_assert(std::is_nothrow_move_constructible_v<Fn>, "inline_function requires nothrow movable callables");
+      ::new (static_cast<void*>(storage_)) Fn(std::forward<F>(f));
+      ops_ = &ops_for<Fn>;
+    }
+
+    inline_function(inline_function&& rhs) noexcept
+    {
+      take(rhs);
+    }
+
+    inline_function& operator=(inline_function&& rhs) noexcept
+    {
+      if (this != &rhs) {
+        reset();
+        take(rhs);
+      }
+      return *this;
+    }
+
+    inline_function& operator=(std::nullptr_t) noexcept
+    {
+      reset();
+      return *this;
+    }
+
+    inline_function(const inline_function&) = delete;
+    inline_function& operator=(const inline_function&) = delete;
+
+    ~inline_function() noexcept
+    {
+      reset();
+    }
+
+    R operator()(Args... args)
+    {
+      return ops_->call(storage_, std::forward<Args>(args)...);
+    }
+
+    explicit operator bool() const noexcept
+    {
+      return ops_ != nullptr;
+    }
+
+    bool operator==(std::nullptr_t) const noexcept
+    {
+      return ops_ == nullptr;
+    }
+
+    /// Destroy the stored callable, if any
+    void reset() noexcept
+    {
+      if (ops_ != nullptr) {
+        ops_->destroy(storage_);
+        ops_ = nullptr;
+      }
+    }
+
+  private:
+    struct Ops {
+      R (*call)(void*, Args&&...);
+      /// Move construct into `dst` and destroy `src`
+      void (*relocate)(void* dst, void* src) noexcept;
+      void (*destroy)(void*) noexcept;
+    };
+
+    template<typename Fn>
+    static constexpr Ops ops_for = {
+      .call = [](void* self, Args&&... args) -> R {
+        return static_cast<R>((*static_cast<Fn*>(self))(std::forward<Args>(args)...));
+      },
+      .relocate =
+        [](void* dst, void* src) noexcept {
+          ::new (dst) Fn(std::move(*static_cast<Fn*>(src)));
+          static_cast<Fn*>(src)->~Fn();
+        },
+      .destroy = [](void* self) noexcept { static_cast<Fn*>(self)->~Fn(); },
+    };
+
+    void take(inline_function& rhs) noexcept
+    {
+      if (rhs.ops_ == nullptr) return;
+      rhs.ops_->relocate(storage_, rhs.storage_);
+      ops_ = std::exchange(rhs.ops_, nullptr);
+    }
+
+    alignas(std::max_align_t) std::byte storage_[Capacity];
+    const Ops* ops_ = nullptr;
+  };
+
+} // namespace otto::util
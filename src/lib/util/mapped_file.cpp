@@ -0,0 +1,34 @@
+#include "mapped_file.hpp"
+
+#include <cerrno>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace otto::util {
+
+  MappedFile::MappedFile(const std::filesystem::path& path)
+  {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) throw std::system_error(errno, std::generic_category(), path.string());
+    struct stat st = {};
+    if (::fstat(fd, &st) == 0) size_ = static_cast<std::size_t>(st.st_size);
+    // Mapping an empty file fails, but there is nothing to map anyway
+    if (size_ > 0) {
+      data_ = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    const int err = errno;
+    // The mapping stays valid after closing the file
+    ::close(fd);
+    if (data_ == MAP_FAILED) throw std::system_error(err, std::generic_category(), path.string());
+  }
+
+  MappedFile::~MappedFile() noexcept
+  {
+    if (size_ > 0) ::munmap(data_, size_);
+  }
+
+} // namespace otto::util
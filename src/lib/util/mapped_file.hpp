@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+namespace otto::util {
+
+  /// A read only memory mapping of a whole file.
+  ///
+  /// The pages are read by the kernel when they are accessed, so parsing straight from
+  /// `bytes()` does not copy the file into a buffer first.
+  struct MappedFile {
+    /// @throws std::system_error if the file can not be opened or mapped
+    explicit MappedFile(const std::filesystem::path& path);
+
+    ~MappedFile() noexcept;
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    [[nodiscard]] std::span<const std::byte> bytes() const noexcept
+    {
+      if (size_ == 0) return {};
+      return {static_cast<const std::byte*>(data_), size_};
+    }
+
+  private:
+    void* data_ = nullptr;
+    std::size_t size_ = 0;
+  };
+
+} // namespace otto::util
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
 #include <string_view>
 
 #include "string_ref.hpp"
@@ -56,6 +57,17 @@ namespace otto::util {
 
     template<typename T>
     constexpr auto name_of_buffer = name_of_impl<T>();
+
+    /// 64 bit FNV-1a hash
+    constexpr std::uint64_t fnv1a(std::string_view sv) noexcept
+    {
+      std::uint64_t hash = 0xcbf29ce484222325;
+      for (char c : sv) {
+        hash ^= static_cast<std::uint8_t>(c);
+        hash *= 0x100000001b3;
+      }
+      return hash;
+    }
   } // namespace detail
 
   /// Compile time fully qualified name of a type.
@@ -75,6 +87,13 @@ namespace otto::util {
   /// the `const char*` is determines equality of the types.
   template<typename T>
   constexpr string_ref name_of = detail::name_of_buffer<T>.data();
+
+  /// Compile time integer id of a type, the hash of its `qualified_name_of`.
+  ///
+  /// Different types get different ids, unless their names collide in the hash,
+  /// which users that store ids can check by comparing the names.
+  template<typename T>
+  constexpr std::uint64_t type_id = detail::fnv1a(detail::qualified_name_of_impl<T>());
 } // namespace otto::util
 
 namespace otto::test {
@@ -89,4 +108,5 @@ namespace otto::test {
                 "otto::test::TestType2<otto::test::TestType, int>");
   static_assert(util::name_of<TestType> == "TestType");
   static_assert(util::name_of<TestType2<TestType, int>> == "TestType2<TestType, int>");
+  static_assert(util::type_id<TestType> != util::type_id<TestType2<TestType, int>>);
 } // namespace otto::test
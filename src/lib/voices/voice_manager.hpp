@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <span>
 
 #include "lib/util/algorithm.hpp"
 #include "lib/util/local_vector.hpp"
@@ -9,6 +10,7 @@
 #include "lib/util/with_limits.hpp"
 
 #include "lib/dsp/SegExpBypass.hpp"
+#include "lib/dsp/control_rate.hpp"
 #include "lib/engine.hpp"
 #include "lib/graphics.hpp"
 #include "lib/midi.hpp"
@@ -46,6 +48,7 @@ namespace otto::voices {
   struct VoiceBase : midi::MidiHandler {
     VoiceBase() : glide_(frequency())
     {
+      glide_.domain(dsp::ControlDomain::master());
       glide_.finish();
     }
 
@@ -69,15 +72,49 @@ namespace otto::voices {
       return volume_;
     }
 
+    /// Whether the frequency is still gliding towards its target
+    ///
+    /// While this is false, `frequency()` is constant, and voices may calculate
+    /// frequency dependent values once per block instead of once per sample.
+    [[nodiscard]] bool is_gliding() const noexcept
+    {
+      return !glide_.done() || frequency_ctl_.is_ramping();
+    }
+
+    /// Whether the voice is silent until it is triggered again.
+    ///
+    /// Idle voices are skipped by VoiceManager::operator() and ::process.
+    /// Voices that know when they are silent, i.e. when all their envelopes
+    /// are done, should hide this. The default never sleeps.
+    [[nodiscard]] bool is_idle() const noexcept
+    {
+      return false;
+    }
+
     void on_note_on() noexcept {}
     void on_note_off() noexcept {}
 
     /// Calculate the next glide points, envelope etc..
     ///
+    /// The glide is stepped at control rate, see dsp::ControlDomain, and interpolated in between.
+    ///
     /// @note Must be called before calling operator(). VoiceManager::operator() and ::process do this.
     void calc_next() noexcept
     {
-      frequency_ = glide_(); /* TODO: * pitch_bend_ */
+      frequency_ = frequency_ctl_([this] { return glide_(); }); /* TODO: * pitch_bend_ */
+    }
+
+    /// Render a block of samples, adding them to `output` scaled by `volume()`
+    ///
+    /// This default implementation calls `calc_next()` and `operator()` for each sample.
+    /// Voices can hide it with their own `process` to do per-block work once per block.
+    void process(std::span<float> output) noexcept requires util::callable<Voice, float()>
+    {
+      auto& self = static_cast<Voice&>(*this);
+      for (float& f : output) {
+        calc_next();
+        f += self() * volume_;
+      }
     }
 
   private:
@@ -104,6 +141,7 @@ namespace otto::voices {
       if (jump || glide_.getEnd() == 1.f) {
         glide_ = frequency_;
         glide_.finish();
+        frequency_ctl_.jump(frequency_);
       } else {
         glide_ = frequency_;
       }
@@ -136,6 +174,7 @@ namespace otto::voices {
     float volume_ = 1.f;
 
     dsp::SegExpBypass<> glide_{1.f, -2.f};
+    dsp::ControlRateValue<float> frequency_ctl_{1.f};
   };
 
   // Voice allocators - Corresponds to different playmodes //
@@ -312,6 +351,12 @@ namespace otto::voices {
       return voices_.end();
     }
 
+    /// All the voices, e.g. to render them together in a voice bank
+    std::span<Voice, N> voices() noexcept
+    {
+      return voices_;
+    }
+
     Voice& operator[](std::size_t i) noexcept
     {
       return voices_[i];
@@ -336,12 +381,29 @@ namespace otto::voices {
     {
       float res = 0;
       for (Voice& v : voices_) {
+        if (v.is_idle()) continue;
         v.calc_next();
         res += v(args...) * v.volume();
       }
       return res;
     }
 
+    /// Render a block of samples from all voices into `output`, replacing its contents
+    void process(std::span<float> output) noexcept
+    {
+      std::ranges::fill(output, 0.f);
+      for (Voice& v : voices_) {
+        if (v.is_idle()) continue;
+        v.process(output);
+      }
+    }
+
+    /// The number of voices that are currently skipped, see VoiceBase::is_idle
+    [[nodiscard]] std::size_t idle_count() const noexcept
+    {
+      return std::ranges::count_if(voices_, [](const Voice& v) { return v.is_idle(); });
+    }
+
   private:
     template<AVoice V, int M>
     friend struct VoiceAllocatorBase;
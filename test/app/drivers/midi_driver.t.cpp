@@ -0,0 +1,56 @@
+#include "testing.t.hpp"
+
+#include "app/drivers/midi_driver.hpp"
+
+#include "stubs/midi.hpp"
+
+using namespace otto;
+using namespace otto::drivers;
+
+TEST_CASE ("MidiDriver") {
+  MidiDriver driver;
+  stubs::StubMidiHandler handler;
+  driver.set_handler(&handler);
+  const auto block_start = chrono::clock::now();
+  // 1 frame per millisecond
+  const std::size_t sample_rate = 1000;
+
+  SECTION ("Timestamps are converted to frame offsets") {
+    driver.controller().send_event(midi::NoteOn{1}, block_start + 10ms);
+    driver.controller().send_event(midi::NoteOn{2}, block_start + 20ms);
+    auto events = driver.collect_events(block_start, 64, sample_rate);
+    REQUIRE(events.size() == 2);
+    REQUIRE(events[0].frame == 10);
+    REQUIRE(events[1].frame == 20);
+    REQUIRE(handler.events.empty());
+  }
+
+  SECTION ("Offsets are clamped to the block") {
+    driver.controller().send_event(midi::NoteOn{1}, block_start - 1s);
+    driver.controller().send_event(midi::NoteOn{2}, block_start + 1s);
+    auto events = driver.collect_events(block_start, 64, sample_rate);
+    REQUIRE(events.size() == 2);
+    REQUIRE(events[0].frame == 0);
+    REQUIRE(events[1].frame == 63);
+  }
+
+  SECTION ("Events are sorted by offset, keeping queue order for equal offsets") {
+    driver.controller().send_event(midi::NoteOn{1}, block_start + 30ms);
+    driver.controller().send_event(midi::NoteOn{2}, block_start + 10ms);
+    driver.controller().send_event(midi::NoteOff{2}, block_start + 10ms);
+    auto events = driver.collect_events(block_start, 64, sample_rate);
+    REQUIRE(events.size() == 3);
+    REQUIRE(events[0].event == midi::MidiEvent(midi::NoteOn{2}));
+    REQUIRE(events[1].event == midi::MidiEvent(midi::NoteOff{2}));
+    REQUIRE(events[2].event == midi::MidiEvent(midi::NoteOn{1}));
+  }
+
+  SECTION ("dispatch updates key states and calls the handler") {
+    driver.dispatch(midi::NoteOn{5});
+    REQUIRE(driver.controller().key_states()[5]);
+    REQUIRE(handler.events.size() == 1);
+    driver.dispatch(midi::NoteOff{5});
+    REQUIRE_FALSE(driver.controller().key_states()[5]);
+    REQUIRE(handler.events.size() == 2);
+  }
+}
@@ -0,0 +1,58 @@
+#include "testing.t.hpp"
+
+#include "app/drivers/offline_audio_driver.hpp"
+
+#include "app/services/audio.hpp"
+
+using namespace otto;
+
+TEST_CASE ("OfflineAudioDriver") {
+  auto driver_ptr = std::make_unique<drivers::OfflineAudioDriver>(64, 44100);
+  auto& driver = *driver_ptr;
+  services::Audio audio(std::move(driver_ptr));
+
+  SECTION ("Renders the requested number of frames") {
+    auto stop = audio.set_process_callback([&](services::Audio::CallbackData data) {
+      std::ranges::fill(data.output.left, 1.f);
+      std::ranges::fill(data.output.right, 1.f);
+    });
+    std::size_t frames = 0;
+    std::vector<std::size_t> block_starts;
+    driver.render(
+      200, [&](std::size_t frame) { block_starts.push_back(frame); },
+      [&](const util::stereo_audio_buffer& out) {
+        REQUIRE(std::ranges::all_of(out.left, [](float f) { return f == 1.f; }));
+        frames += out.size();
+      });
+    REQUIRE(frames == 200);
+    REQUIRE(block_starts == std::vector<std::size_t>{0, 64, 128, 192});
+    REQUIRE(driver.frame() == 200);
+  }
+
+  SECTION ("Midi events are scheduled at their frame, one buffer late") {
+    struct Handler : midi::MidiHandler {
+      void handle(midi::NoteOn) noexcept override
+      {
+        on = true;
+      }
+      bool on = false;
+    } handler;
+    auto stop_midi = audio.set_midi_handler(&handler);
+    std::size_t frame = 0;
+    tl::optional<std::size_t> note_on_frame;
+    auto stop = audio.set_process_callback([&](services::Audio::CallbackData data) {
+      if (handler.on && !note_on_frame) note_on_frame = frame;
+      frame += data.output.size();
+    });
+    driver.render(
+      256,
+      [&](std::size_t f) {
+        if (f != 0) return;
+        // The callback is also run between renders, so only count from here
+        frame = 0;
+        audio.midi().send_event(midi::NoteOn{60}, driver.time_of(10));
+      },
+      [](auto&&) {});
+    REQUIRE(note_on_frame == 64 + 10);
+  }
+}
@@ -0,0 +1,69 @@
+#include "testing.t.hpp"
+
+#include <Gamma/Domain.h>
+
+#include "app/engines/midi-fx/arp/arp.hpp"
+#include "app/services/audio.hpp"
+#include "lib/util/at_exit.hpp"
+
+using namespace otto;
+using namespace otto::engines::arp;
+
+TEST_CASE ("Arp timing") {
+  itc::ImmediateExecutor ex;
+  AudioDomain::set_static_executor(ex);
+  // Also reset when a REQUIRE fails, so later tests do not use the destroyed executor
+  util::at_exit reset([] { AudioDomain::set_static_executor(nullptr); });
+
+  itc::Context ctx;
+  auto audio = make_audio(ctx);
+  audio->handle(midi::NoteOn{60});
+
+  // With the default state, a beat is 6400 frames, and the note is released after 1280
+  constexpr std::size_t block = 300;
+  std::vector<std::pair<std::size_t, midi::TimedMidiEvent>> events;
+  for (std::size_t b = 0; b < 22; b++) {
+    for (const auto& e : audio->process(block)) events.emplace_back(b, e);
+  }
+
+  SECTION ("Notes are placed at their frame inside the block") {
+    REQUIRE(events.size() == 3);
+    REQUIRE(events[0].first == 0);
+    REQUIRE(events[0].second.frame == 0);
+    REQUIRE(std::holds_alternative<midi::NoteOn>(events[0].second.event));
+    REQUIRE(events[1].first == 1280 / block);
+    REQUIRE(events[1].second.frame == 1280 % block);
+    REQUIRE(std::holds_alternative<midi::NoteOff>(events[1].second.event));
+    REQUIRE(events[2].first == 6400 / block);
+    REQUIRE(events[2].second.frame == 6400 % block);
+    REQUIRE(std::holds_alternative<midi::NoteOn>(events[2].second.event));
+  }
+}
+
+TEST_CASE ("Arp tempo follows the sample rate") {
+  itc::ImmediateExecutor ex;
+  AudioDomain::set_static_executor(ex);
+  const double old_rate = gam::sampleRate();
+  gam::sampleRate(48000);
+  util::at_exit reset([old_rate] {
+    gam::sampleRate(old_rate);
+    AudioDomain::set_static_executor(nullptr);
+  });
+
+  itc::Context ctx;
+  itc::Producer<State> logic = {ctx};
+  auto audio = make_audio(ctx);
+  logic.state().bpm = 120;
+  logic.commit();
+  audio->handle(midi::NoteOn{60});
+
+  // 120 bpm at 48 kHz is 24000 frames per beat
+  std::vector<std::size_t> note_ons;
+  constexpr std::size_t block = 256;
+  for (std::size_t b = 0; b < 100; b++) {
+    for (const auto& e : audio->process(block)) {
+      if (std::holds_alternative<midi::NoteOn>(e.event)) note_ons.push_back(b * block + e.frame);
+    }
+  }
+  REQUIRE(note_ons == std::vector<std::size_t>{0, 24000});
+}
@@ -83,8 +83,7 @@ TEST_CASE ("ottofm-all", "[.interactive][engine]") {
 
   auto stop_midi = audio.set_midi_handler(&eng.audio->midi_handler());
   auto stop_audio = audio.set_process_callback([&](Audio::CallbackData data) {
-    const auto res = eng.audio->process();
-    std::ranges::copy(util::zip(res, res), data.output.begin());
+    eng.audio->process(data.output, util::MixMode::replace);
   });
 
   auto stop_graphics = graphics.show(nav_km.nav());
@@ -0,0 +1,89 @@
+#include "testing.t.hpp"
+
+#include "app/engines/synths/ottofm/fm_bank.hpp"
+
+#include "lib/util/ranges.hpp"
+
+using namespace otto;
+using namespace otto::engines::ottofm;
+
+TEST_CASE ("FMVoiceBank") {
+  itc::ImmediateExecutor ex;
+  AudioDomain::set_static_executor(ex);
+  gam::sampleRate(44100);
+
+  itc::Channel chan;
+  State state;
+  state.operators[1].ratio_idx = 20;
+  state.operators[2].detune = 0.3f;
+  state.operators[3].shape = 0.8f;
+  state.operators[3].level = 0.6f;
+
+  SECTION ("Matches FMOperator within tolerance for all algorithms") {
+    for (int alg = 0; alg < Voice::algorithm_count; alg++) {
+      INFO("algorithm = " << alg);
+      state.algorithm_idx = alg;
+      voices::VoiceManager<Voice, 6> reference(chan, state);
+      voices::VoiceManager<Voice, 6> banked(chan, state);
+      FMVoiceBank<6> bank;
+      for (auto* vmgr : {&reference, &banked}) {
+        for (auto& v : *vmgr) v.on_state_change(state);
+        vmgr->handle(midi::NoteOn{60});
+        vmgr->handle(midi::NoteOn{67});
+      }
+
+      std::array<float, 256> expected;
+      std::array<float, 256> got;
+      for (int block = 0; block < 4; block++) {
+        if (block == 2) {
+          reference.handle(midi::NoteOff{60});
+          banked.handle(midi::NoteOff{60});
+        }
+        reference.process(expected);
+        bank.process(banked.voices(), got);
+        for (auto&& [e, g] : util::zip(expected, got)) {
+          REQUIRE(g == test::approx(e).margin(1e-3));
+        }
+      }
+    }
+  }
+
+  SECTION ("Writes both channels of a stereo buffer, replacing or accumulating") {
+    voices::VoiceManager<Voice, 6> mono_vmgr(chan, state);
+    voices::VoiceManager<Voice, 6> stereo_vmgr(chan, state);
+    FMVoiceBank<6> mono_bank;
+    FMVoiceBank<6> stereo_bank;
+    for (auto* vmgr : {&mono_vmgr, &stereo_vmgr}) {
+      for (auto& v : *vmgr) v.on_state_change(state);
+      vmgr->handle(midi::NoteOn{60});
+    }
+
+    std::array<float, 64> mono;
+    std::vector<float> data(64 * 2, 0.5f);
+    auto stereo = util::stereo_audio_buffer(util::audio_buffer(std::span(data).first(64), nullptr),
+                                            util::audio_buffer(std::span(data).last(64), nullptr));
+
+    mono_bank.process(mono_vmgr.voices(), mono);
+    stereo_bank.process(stereo_vmgr.voices(), stereo, util::MixMode::accumulate);
+    for (auto&& [m, l, r] : util::zip(mono, stereo.left, stereo.right)) {
+      REQUIRE(l == test::approx(m + 0.5f));
+      REQUIRE(r == test::approx(m + 0.5f));
+    }
+
+    mono_bank.process(mono_vmgr.voices(), mono);
+    stereo_bank.process(stereo_vmgr.voices(), stereo, util::MixMode::replace);
+    for (auto&& [m, l, r] : util::zip(mono, stereo.left, stereo.right)) {
+      REQUIRE(l == test::approx(m));
+      REQUIRE(r == test::approx(m));
+    }
+  }
+
+  SECTION ("Silent when no voices are triggered") {
+    voices::VoiceManager<Voice, 6> vmgr(chan, state);
+    FMVoiceBank<6> bank;
+    std::array<float, 64> out;
+    out.fill(1.f);
+    bank.process(vmgr.voices(), out);
+    for (float f : out) REQUIRE(f == 0.f);
+  }
+}
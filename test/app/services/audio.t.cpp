@@ -8,6 +8,8 @@
 #include "app/services/config.hpp"
 #include "app/services/runtime.hpp"
 
+#include "stubs/audio.hpp"
+
 using namespace otto;
 using namespace otto::services;
 using namespace std::literals;
@@ -54,3 +56,24 @@ TEST_CASE ("midi queue") {
   }
   REQUIRE(handler.note == 5);
 }
+
+TEST_CASE ("audio timing stats") {
+  auto driver = std::make_unique<stubs::NoProcessAudioDriver>();
+  auto& drv = *driver;
+  Audio audio(std::move(driver));
+  std::vector<float> data(4 * drv.buffer_size());
+  const auto n = drv.buffer_size();
+  auto input = util::stereo_audio_buffer(util::audio_buffer(std::span(data.data(), n), nullptr),
+                                         util::audio_buffer(std::span(data.data() + n, n), nullptr));
+  auto output = util::stereo_audio_buffer(util::audio_buffer(std::span(data.data() + 2 * n, n), nullptr),
+                                          util::audio_buffer(std::span(data.data() + 3 * n, n), nullptr));
+  drv.callback({.input = input, .output = output});
+  drv.callback({.input = input, .output = output, .xrun = true});
+  auto stats = audio.timing_stats();
+  REQUIRE(stats.callbacks == 2);
+  REQUIRE(stats.xruns == 1);
+  REQUIRE(stats.peak_load > 0);
+  audio.reset_timing_stats();
+  drv.callback({.input = input, .output = output});
+  REQUIRE(audio.timing_stats().callbacks == 1);
+}
@@ -0,0 +1,76 @@
+#include "testing.t.hpp"
+
+#include "app/services/presets.hpp"
+
+#include "lib/util/exception.hpp"
+
+using namespace otto;
+using namespace otto::services;
+
+TEST_CASE ("PresetLibrary") {
+  auto root = test::temp_file("presets");
+  fs::create_directories(root / "OTTO.FM");
+  fs::create_directories(root / "Potion");
+  json::write_to_file({{"engine", "OTTO.FM"}, {"name", "Bells"}, {"tags", {"keys"}}, {"value", 1}},
+                      root / "OTTO.FM" / "bells.json");
+  json::write_to_file({{"engine", "OTTO.FM"}, {"name", "Anvil"}, {"value", 2}}, root / "OTTO.FM" / "anvil.cbor");
+  // Without a name or engine, they are taken from the file and directory names
+  json::write_to_file({{"value", 3}}, root / "Potion" / "Brew.json");
+  {
+    std::ofstream f(root / "Potion" / "broken.json");
+    f << "{ not json";
+  }
+  {
+    std::ofstream f(root / "Potion" / "notes.txt");
+    f << "not a preset";
+  }
+
+  PresetLibrary lib(root, 2);
+  const auto index = lib.wait_for_index().sync_wait();
+
+  SECTION ("The index is sorted by engine and name") {
+    REQUIRE(index->size() == 3);
+    REQUIRE((*index)[0].name == "Anvil");
+    REQUIRE((*index)[1].name == "Bells");
+    REQUIRE((*index)[1].tags == std::vector<std::string>{"keys"});
+    REQUIRE((*index)[2].name == "Brew");
+    REQUIRE((*index)[2].engine == "Potion");
+    REQUIRE(lib.index() == index);
+  }
+
+  SECTION ("Presets of an engine") {
+    REQUIRE(PresetLibrary::presets_of(*index, "OTTO.FM").size() == 2);
+    REQUIRE(PresetLibrary::presets_of(*index, "Potion").size() == 1);
+    REQUIRE(PresetLibrary::presets_of(*index, "Goss").empty());
+  }
+
+  SECTION ("Bodies are loaded on demand, and cached") {
+    const auto body = lib.load(0).sync_wait();
+    REQUIRE(body->at("value") == 2);
+    REQUIRE(lib.load(0).sync_wait() == body);
+  }
+
+  SECTION ("The least recently used body is evicted") {
+    const auto b0 = lib.load(0).sync_wait();
+    const auto b1 = lib.load(1).sync_wait();
+    REQUIRE(lib.load(0).sync_wait() == b0);
+    (void) lib.load(2).sync_wait();
+    REQUIRE(lib.load(0).sync_wait() == b0);
+    REQUIRE(lib.load(1).sync_wait() != b1);
+  }
+
+  SECTION ("Prefetching loads the neighbours") {
+    lib.prefetch(0, 1);
+    // Wait for the prefetch, which was queued before
+    (void) lib.wait_for_index().sync_wait();
+    // Loaded from the cache, without reading the files
+    for (const auto& p : *index) fs::remove(p.path);
+    REQUIRE(lib.load(0).sync_wait()->at("value") == 2);
+    REQUIRE(lib.load(1).sync_wait()->at("value") == 1);
+    REQUIRE_THROWS_AS(lib.load(2).sync_wait(), util::exception);
+  }
+
+  SECTION ("Loading a preset that does not exist throws") {
+    REQUIRE_THROWS_AS(lib.load(3).sync_wait(), util::exception);
+  }
+}
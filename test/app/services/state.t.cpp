@@ -2,6 +2,10 @@
 
 #include "app/services/state.hpp"
 
+#include <fstream>
+
+#include "lib/itc/itc.hpp"
+
 #include "app/services/runtime.hpp"
 
 #include "stubs/state.hpp"
@@ -90,3 +94,87 @@ TEST_CASE ("StateManager destruction 2") {
   }
   REQUIRE(StubSer::destructed == 1);
 }
+
+TEST_CASE ("StateManager journal") {
+  using namespace services;
+  itc::ImmediateExecutor ex;
+  itc::StaticDomain<>::set_static_executor(ex);
+
+  auto path = test::temp_file("statemanager_journal.json");
+  std::filesystem::remove(StateJournal::journal_path(path));
+
+  itc::Context ctx;
+  itc::Producer<stubs::State2> prod{ctx["child"]};
+  int i = 1;
+  auto v = util::visitable([&](auto&& visit) { visit("i", i); });
+
+  SECTION ("Changes survive without writing the state file") {
+    {
+      StateManager stateman{path};
+      stateman.add("Context", std::ref(ctx));
+      stateman.add("Test", std::ref(v));
+      stateman.start_journal();
+      prod.state().i = 10;
+      prod.commit();
+      i = 20;
+      stateman.journal_changes();
+      stateman.flush_journal();
+      // Destroyed without write_to_file, like in a crash
+    }
+    prod.state().i = 0;
+    i = 0;
+    StateManager stateman{path};
+    stateman.add("Context", std::ref(ctx));
+    stateman.add("Test", std::ref(v));
+    stateman.read_from_file();
+    REQUIRE(prod.state().i == 10);
+    REQUIRE(i == 20);
+  }
+
+  SECTION ("Only changed producers are journaled") {
+    itc::Producer<stubs::simple_states::S1> other{ctx};
+    StateManager stateman{path};
+    stateman.add("Context", std::ref(ctx));
+    stateman.start_journal();
+    prod.commit();
+    stateman.journal_changes();
+    stateman.flush_journal();
+    std::ifstream journal(StateJournal::journal_path(path));
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(journal, line);) lines.push_back(line);
+    REQUIRE(lines.size() == 1);
+    REQUIRE(json::value::parse(lines[0])["path"][1] == "child");
+  }
+
+  SECTION ("An idle app writes no journal records") {
+    // Like the states the audio engines commit every block, which are not saved
+    struct AudioState {
+      int frames = 0;
+    };
+    itc::Producer<AudioState> audio{ctx};
+    StateManager stateman{path};
+    stateman.add("Context", std::ref(ctx));
+    stateman.start_journal();
+    for (int n = 0; n < 10; n++) {
+      audio.state().frames += 64;
+      audio.commit();
+      stateman.journal_changes();
+    }
+    stateman.flush_journal();
+    const auto journal = StateJournal::journal_path(path);
+    REQUIRE((!std::filesystem::exists(journal) || std::filesystem::file_size(journal) == 0));
+  }
+
+  SECTION ("Writing the state file compacts the journal") {
+    StateManager stateman{path};
+    stateman.add("Context", std::ref(ctx));
+    stateman.start_journal();
+    prod.state().i = 5;
+    prod.commit();
+    stateman.write_to_file();
+    REQUIRE(std::filesystem::file_size(StateJournal::journal_path(path)) == 0);
+    const auto child = json::parse_file(path)["Context"]["child"];
+    REQUIRE(child.size() == 1);
+    REQUIRE(child.begin()->at("i") == 5);
+  }
+}
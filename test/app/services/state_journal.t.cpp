@@ -0,0 +1,49 @@
+#include "testing.t.hpp"
+
+#include "app/services/state_journal.hpp"
+
+#include <fstream>
+
+using namespace otto;
+using namespace otto::services;
+
+TEST_CASE ("StateJournal") {
+  auto path = test::temp_file("journal_state.json");
+  std::filesystem::remove(StateJournal::journal_path(path));
+
+  SECTION ("Records are replayed on top of the state file") {
+    {
+      StateJournal journal(path, json::object{{"a", 1}, {"b", {{"c", 2}}}});
+      journal.append({{{"b", "c"}, 3}, {{"d"}, 4}});
+      journal.append({{{"a"}, 5}});
+      journal.flush();
+    }
+    REQUIRE(json::parse_file(path) == json::value{{"a", 1}, {"b", {{"c", 2}}}});
+    REQUIRE(StateJournal::load(path) == json::value{{"a", 5}, {"b", {{"c", 3}}}, {"d", 4}});
+  }
+
+  SECTION ("A record that was cut off is ignored") {
+    {
+      StateJournal journal(path, json::object{{"a", 1}});
+      journal.append({{{"a"}, 2}});
+      journal.flush();
+    }
+    {
+      std::ofstream f(StateJournal::journal_path(path), std::ios::app);
+      f << R"({"path":["a"],"val)";
+    }
+    REQUIRE(StateJournal::load(path) == json::value{{"a", 2}});
+  }
+
+  SECTION ("The journal is compacted after enough records") {
+    StateJournal journal(path, json::object{{"a", 0}}, 4);
+    for (int i = 1; i <= 4; i++) journal.append({{{"a"}, i}});
+    journal.flush();
+    REQUIRE(std::filesystem::file_size(StateJournal::journal_path(path)) == 0);
+    REQUIRE(json::parse_file(path) == json::value{{"a", 4}});
+  }
+
+  SECTION ("Nothing to load") {
+    REQUIRE(StateJournal::load(path).is_null());
+  }
+}
@@ -0,0 +1,202 @@
+#include "testing.t.hpp"
+
+#include <mutex>
+#include <set>
+
+#include "lib/audio_graph.hpp"
+
+using namespace otto;
+
+TEST_CASE ("AudioGraph") {
+  SECTION ("schedule respects dependencies") {
+    AudioGraph graph(0);
+    auto a = graph.add_node("a", [](std::size_t) noexcept {});
+    auto b = graph.add_node("b", [](std::size_t) noexcept {});
+    auto c = graph.add_node("c", [](std::size_t) noexcept {});
+    graph.connect(c, b);
+    graph.connect(b, a);
+    REQUIRE(graph.schedule() == std::vector<AudioGraph::NodeId>{c, b, a});
+  }
+
+  SECTION ("Connecting a cycle throws") {
+    AudioGraph graph(0);
+    auto a = graph.add_node("a", [](std::size_t) noexcept {});
+    auto b = graph.add_node("b", [](std::size_t) noexcept {});
+    graph.connect(a, b);
+    REQUIRE_THROWS(graph.connect(b, a));
+    REQUIRE_THROWS(graph.connect(a, a));
+  }
+
+  SECTION ("Every node runs once per block, after its inputs") {
+    for (std::size_t workers : {0, 1, 3}) {
+      AudioGraph graph(workers);
+      std::mutex mutex;
+      std::vector<AudioGraph::NodeId> order;
+      std::vector<std::size_t> frames;
+      // Two independent chains of 4 nodes, mixed by a final node
+      std::vector<AudioGraph::NodeId> ids;
+      for (int i = 0; i < 9; i++) {
+        ids.push_back(graph.add_node(fmt::format("node{}", i), [&, i](std::size_t nframes) noexcept {
+          std::scoped_lock l(mutex);
+          order.push_back(i);
+          frames.push_back(nframes);
+        }));
+      }
+      for (int i = 0; i < 3; i++) {
+        graph.connect(ids[i], ids[i + 1]);
+        graph.connect(ids[4 + i], ids[4 + i + 1]);
+      }
+      graph.connect(ids[3], ids[8]);
+      graph.connect(ids[7], ids[8]);
+      graph.compile(64);
+      REQUIRE(graph.worker_count() == std::min<std::size_t>(workers, 1));
+
+      for (int block = 0; block < 100; block++) {
+        order.clear();
+        frames.clear();
+        graph.process(64);
+        REQUIRE(order.size() == 9);
+        REQUIRE(std::ranges::all_of(frames, [](auto f) { return f == 64; }));
+        auto pos = [&](std::size_t id) { return std::ranges::find(order, id) - order.begin(); };
+        for (int i = 0; i < 3; i++) {
+          REQUIRE(pos(i) < pos(i + 1));
+          REQUIRE(pos(4 + i) < pos(4 + i + 1));
+        }
+        REQUIRE(order.back() == 8);
+      }
+      REQUIRE(graph.deadline_misses() == 0);
+    }
+  }
+
+  SECTION ("Workers are only started for parallel branches") {
+    AudioGraph graph(3);
+    auto a = graph.add_node("a", [](std::size_t) noexcept {});
+    auto b = graph.add_node("b", [](std::size_t) noexcept {});
+    graph.connect(a, b);
+    graph.compile(64);
+    REQUIRE(graph.worker_count() == 0);
+
+    for (int i = 0; i < 3; i++) graph.connect(a, graph.add_node("c", [](std::size_t) noexcept {}));
+    graph.compile(64);
+    REQUIRE(graph.worker_count() == 3);
+  }
+
+  SECTION ("Nodes are skipped after the deadline") {
+    AudioGraph graph(1);
+    int runs = 0;
+    graph.add_node("a", [&](std::size_t) noexcept { runs++; });
+    graph.process(64, chrono::clock::now() - std::chrono::milliseconds(1));
+    REQUIRE(runs == 0);
+    REQUIRE(graph.deadline_misses() == 1);
+    graph.process(64);
+    REQUIRE(runs == 1);
+    REQUIRE(graph.deadline_misses() == 1);
+  }
+
+  SECTION ("Buffer plan reuses slots of a chain") {
+    AudioGraph graph(0);
+    auto a = graph.add_node("a", [](std::size_t) noexcept {}, 1);
+    auto b = graph.add_node("b", [](std::size_t) noexcept {}, 1);
+    auto c = graph.add_node("c", [](std::size_t) noexcept {}, 1);
+    auto d = graph.add_node("d", [](std::size_t) noexcept {}, 1);
+    graph.connect(a, b);
+    graph.connect(b, c);
+    graph.connect(c, d);
+    graph.compile(64);
+    const auto& plan = graph.buffer_plan();
+    // A node never writes to the slot it reads from, so a chain alternates between two slots
+    REQUIRE(plan.slot_count == 2);
+    REQUIRE(plan.slots[a][0] != plan.slots[b][0]);
+    REQUIRE(plan.slots[c][0] == plan.slots[a][0]);
+    REQUIRE(plan.slots[d][0] == plan.slots[b][0]);
+    REQUIRE(graph.arena_bytes() == 2 * 64 * sizeof(float));
+  }
+
+  SECTION ("Buffer plan does not share slots between parallel chains") {
+    AudioGraph graph(0);
+    auto a1 = graph.add_node("a1", [](std::size_t) noexcept {}, 2);
+    auto b1 = graph.add_node("b1", [](std::size_t) noexcept {}, 2);
+    auto a2 = graph.add_node("a2", [](std::size_t) noexcept {}, 2);
+    auto b2 = graph.add_node("b2", [](std::size_t) noexcept {}, 2);
+    auto mix = graph.add_node("mix", [](std::size_t) noexcept {}, 2);
+    graph.connect(a1, b1);
+    graph.connect(a2, b2);
+    graph.connect(b1, mix);
+    graph.connect(b2, mix);
+    graph.compile(64);
+    const auto& plan = graph.buffer_plan();
+    std::set<std::size_t> chain_slots;
+    for (auto id : {a1, b1, a2, b2}) {
+      for (auto slot : plan.slots[id]) chain_slots.insert(slot);
+    }
+    // The chains may run at the same time, so all their buffers are distinct
+    REQUIRE(chain_slots.size() == 8);
+    // The mix runs after both chains, so it reuses the buffers of a1 or a2
+    REQUIRE(plan.slot_count == 8);
+    for (auto slot : plan.slots[mix]) {
+      REQUIRE(std::ranges::find(plan.slots[b1], slot) == plan.slots[b1].end());
+      REQUIRE(std::ranges::find(plan.slots[b2], slot) == plan.slots[b2].end());
+    }
+  }
+
+  SECTION ("Output buffers pass audio between nodes") {
+    AudioGraph graph(2);
+    AudioGraph::NodeId gen = 0;
+    AudioGraph::NodeId gain = 0;
+    gen = graph.add_node(
+      "gen", [&](std::size_t) noexcept { std::ranges::fill(graph.output(gen, 0), 1.f); }, 1);
+    gain = graph.add_node(
+      "gain",
+      [&](std::size_t) noexcept {
+        std::ranges::transform(graph.output(gen, 0), graph.output(gain, 0).begin(), [](float f) { return f * 0.5f; });
+      },
+      1);
+    graph.connect(gen, gain);
+    graph.compile(64);
+    graph.process(32);
+    auto out = graph.output(gain, 0);
+    REQUIRE(out.size() == 32);
+    REQUIRE(std::ranges::all_of(out, [](float f) { return f == 0.5f; }));
+  }
+
+  SECTION ("Bound outputs are written in place") {
+    AudioGraph graph(0);
+    AudioGraph::NodeId gen = 0;
+    gen = graph.add_node(
+      "gen", [&](std::size_t) noexcept { std::ranges::fill(graph.output(gen, 0), 1.f); }, 1);
+    graph.compile(64);
+    std::vector<float> driver(32, 0.f);
+    graph.bind_output(gen, 0, driver);
+    graph.process(32);
+    REQUIRE(graph.output(gen, 0).data() == driver.data());
+    REQUIRE(std::ranges::all_of(driver, [](float f) { return f == 1.f; }));
+
+    // Unbinding uses the planned slot again
+    graph.bind_output(gen, 0, {});
+    std::ranges::fill(driver, 0.f);
+    graph.process(32);
+    REQUIRE(graph.output(gen, 0).data() != driver.data());
+    REQUIRE(std::ranges::all_of(driver, [](float f) { return f == 0.f; }));
+  }
+
+  SECTION ("Output buffers are taken from a pool, one per slot") {
+    util::AudioBufferPool pool(4, 64);
+    {
+      AudioGraph graph(0);
+      auto a = graph.add_node("a", [](std::size_t) noexcept {}, 2);
+      auto b = graph.add_node("b", [](std::size_t) noexcept {}, 1);
+      graph.connect(a, b);
+      graph.compile(pool);
+      REQUIRE(pool.in_use() == graph.buffer_plan().slot_count);
+      // Compiling again returns the buffers of the previous plan first
+      graph.compile(pool);
+      REQUIRE(pool.in_use() == graph.buffer_plan().slot_count);
+    }
+    REQUIRE(pool.in_use() == 0);
+
+    AudioGraph graph(0);
+    graph.add_node("big", [](std::size_t) noexcept {}, 5);
+    REQUIRE_THROWS_AS(graph.compile(pool), util::exception);
+    REQUIRE(pool.in_use() == 0);
+  }
+}
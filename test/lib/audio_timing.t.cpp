@@ -0,0 +1,48 @@
+#include "testing.t.hpp"
+
+#include "lib/audio_timing.hpp"
+
+using namespace otto;
+
+TEST_CASE ("AudioTimingStats") {
+  AudioTimingStats stats;
+
+  SECTION ("Empty") {
+    auto s = stats.snapshot();
+    REQUIRE(s.callbacks == 0);
+    REQUIRE(s.mean_load == 0);
+    REQUIRE(s.percentile(0.99f) == 0);
+  }
+
+  SECTION ("Records loads and xruns") {
+    stats.record(0.25f);
+    stats.record(0.35f);
+    stats.record(0.45f, true);
+    stats.record(1.5f);
+    stats.record(10.f);
+    auto s = stats.snapshot();
+    REQUIRE(s.callbacks == 5);
+    REQUIRE(s.xruns == 1);
+    REQUIRE(s.overruns == 2);
+    REQUIRE(s.peak_load == test::approx(10.f));
+    REQUIRE(s.mean_load == test::approx(12.55f / 5.f));
+    REQUIRE(s.histogram[2] == 1);
+    REQUIRE(s.histogram[3] == 1);
+    REQUIRE(s.histogram[4] == 1);
+    REQUIRE(s.histogram[15] == 1);
+    // Loads above the range go in the last bucket
+    REQUIRE(s.histogram.back() == 1);
+    REQUIRE(s.percentile(0.5f) == test::approx(0.4f));
+    REQUIRE(s.percentile(1.f) == test::approx(2.f));
+  }
+
+  SECTION ("Reset takes effect at the next record") {
+    stats.record(0.5f, true);
+    stats.reset();
+    stats.record(0.1f);
+    auto s = stats.snapshot();
+    REQUIRE(s.callbacks == 1);
+    REQUIRE(s.xruns == 0);
+    REQUIRE(s.peak_load == test::approx(0.1f));
+  }
+}
@@ -0,0 +1,54 @@
+#include "testing.t.hpp"
+
+#include "lib/dsp/control_rate.hpp"
+
+using namespace otto;
+using namespace otto::dsp;
+
+TEST_CASE ("ControlDomain") {
+  gam::sampleRate(48000);
+
+  SECTION ("Runs at the master rate divided by the decimation") {
+    ControlDomain domain(16);
+    REQUIRE(domain.spu() == test::approx(3000));
+    domain.decimation(32);
+    REQUIRE(domain.spu() == test::approx(1500));
+  }
+
+  SECTION ("Follows changes to the master rate") {
+    ControlDomain domain(16);
+    gam::sampleRate(44100);
+    REQUIRE(domain.spu() == test::approx(44100.f / 16));
+    gam::sampleRate(48000);
+  }
+}
+
+TEST_CASE ("ControlRateValue") {
+  ControlDomain domain(4);
+  ControlRateValue<float> value(0.f, domain);
+
+  SECTION ("calc is called once per control period") {
+    int calls = 0;
+    for (int i = 0; i < 16; i++) value([&] { return float(++calls); });
+    REQUIRE(calls == 4);
+  }
+
+  SECTION ("Interpolates linearly to the target over one control period") {
+    auto target = [] { return 4.f; };
+    REQUIRE(value(target) == test::approx(1.f));
+    REQUIRE(value.is_ramping());
+    REQUIRE(value(target) == test::approx(2.f));
+    REQUIRE(value(target) == test::approx(3.f));
+    REQUIRE(value(target) == test::approx(4.f));
+    REQUIRE_FALSE(value.is_ramping());
+    REQUIRE(value(target) == test::approx(4.f));
+    REQUIRE_FALSE(value.is_ramping());
+  }
+
+  SECTION ("jump skips the interpolation") {
+    value([] { return 4.f; });
+    value.jump(10.f);
+    REQUIRE(value.value() == 10.f);
+    REQUIRE(value([] { return 10.f; }) == 10.f);
+  }
+}
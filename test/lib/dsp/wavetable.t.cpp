@@ -0,0 +1,177 @@
+#include "testing.t.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <numbers>
+
+#include "lib/dsp/wavetable.hpp"
+#include "lib/util/exception.hpp"
+
+using namespace otto;
+using namespace otto::dsp;
+
+namespace {
+  /// The amplitude of harmonic `h` in one period of `x`
+  double harmonic(std::span<const float> x, std::size_t h)
+  {
+    const std::size_t n = Wavetable::size;
+    double re = 0;
+    double im = 0;
+    for (std::size_t k = 0; k < n; k++) {
+      const double w = 2 * std::numbers::pi * double(h * k % n) / double(n);
+      re += x[k] * std::cos(w);
+      im += x[k] * std::sin(w);
+    }
+    return std::hypot(re, im) * 2 / double(n);
+  }
+
+  std::vector<float> saw(std::size_t n)
+  {
+    std::vector<float> res(n);
+    for (std::size_t i = 0; i < n; i++) res[i] = 1.f - 2.f * float(i) / float(n);
+    return res;
+  }
+
+  /// A mono 16 bit wav file
+  std::vector<std::byte> make_wav(std::span<const float> samples)
+  {
+    std::vector<std::byte> res;
+    const auto put = [&](const auto& v) {
+      const auto* p = reinterpret_cast<const std::byte*>(&v);
+      res.insert(res.end(), p, p + sizeof(v));
+    };
+    const auto put_id = [&](const char* id) {
+      const auto* p = reinterpret_cast<const std::byte*>(id);
+      res.insert(res.end(), p, p + 4);
+    };
+    const auto data_size = static_cast<std::uint32_t>(samples.size() * 2);
+    put_id("RIFF");
+    put(std::uint32_t{36} + data_size);
+    put_id("WAVE");
+    put_id("fmt ");
+    put(std::uint32_t{16});
+    put(std::uint16_t{1});
+    put(std::uint16_t{1});
+    put(std::uint32_t{44100});
+    put(std::uint32_t{44100 * 2});
+    put(std::uint16_t{2});
+    put(std::uint16_t{16});
+    put_id("data");
+    put(data_size);
+    for (float f : samples) put(static_cast<std::int16_t>(std::lround(f * 32767.f)));
+    return res;
+  }
+} // namespace
+
+TEST_CASE ("Wavetable") {
+  const auto cycle = saw(256);
+  const Wavetable table(cycle);
+
+  SECTION ("Each level has no harmonics above its limit") {
+    for (std::size_t l = 0; l < Wavetable::levels; l++) {
+      INFO("level = " << l);
+      const auto level = table.level(l);
+      const auto max = Wavetable::max_harmonic(l);
+      REQUIRE(harmonic(level, 1) > 0.1);
+      for (std::size_t h = max + 1; h <= std::min<std::size_t>(2 * max + 4, Wavetable::size / 2 - 1); h++) {
+        REQUIRE(harmonic(level, h) < 1e-4);
+      }
+    }
+  }
+
+  SECTION ("Levels end with a copy of the first sample") {
+    for (std::size_t l = 0; l < Wavetable::levels; l++) {
+      const auto level = table.level(l);
+      REQUIRE(level.size() == Wavetable::stride);
+      REQUIRE(level[Wavetable::size] == level[0]);
+    }
+  }
+
+  SECTION ("Level 0 is normalized") {
+    float peak = 0;
+    for (float f : table.level(0)) peak = std::max(peak, std::abs(f));
+    REQUIRE(peak == test::approx(1.f));
+  }
+
+  SECTION ("level_for picks the first level without aliasing") {
+    REQUIRE(Wavetable::level_for(0) == 0);
+    REQUIRE(Wavetable::level_for(1.f / 2048) == 0);
+    REQUIRE(Wavetable::level_for(1.f / 1024) == 1);
+    REQUIRE(Wavetable::level_for(0.49f) == Wavetable::levels - 1);
+    for (float freq : {20.f, 100.f, 440.f, 1000.f, 5000.f}) {
+      INFO("freq = " << freq);
+      const float cps = freq / 44100.f;
+      const auto l = Wavetable::level_for(cps);
+      REQUIRE(float(Wavetable::max_harmonic(l)) * cps <= 0.5f);
+      if (l > 0) REQUIRE(float(Wavetable::max_harmonic(l - 1)) * cps > 0.5f);
+    }
+  }
+
+  SECTION ("Loads a cycle from a wav file") {
+    const auto path = test::temp_file("saw.wav");
+    const auto wav = make_wav(cycle);
+    std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(wav.data()), std::streamsize(wav.size()));
+
+    const auto loaded = Wavetable::load(path);
+    for (std::size_t i = 0; i < Wavetable::stride; i++) {
+      REQUIRE(loaded.level(3)[i] == test::approx(table.level(3)[i]).margin(1e-3));
+    }
+  }
+}
+
+TEST_CASE ("decode_wav") {
+  SECTION ("Decodes 16 bit PCM") {
+    const std::vector<float> samples = {0.f, 0.5f, -0.5f, 1.f};
+    const auto res = decode_wav(make_wav(samples));
+    REQUIRE(res.size() == samples.size());
+    for (std::size_t i = 0; i < samples.size(); i++) REQUIRE(res[i] == test::approx(samples[i]).margin(1e-4));
+  }
+
+  SECTION ("Throws on invalid files") {
+    REQUIRE_THROWS_AS(decode_wav(std::vector<std::byte>(20)), util::exception);
+    auto wav = make_wav(saw(16));
+    // Truncated before the data chunk
+    REQUIRE_THROWS_AS(decode_wav(std::span(wav).first(36)), util::exception);
+    // 8 bit samples are not supported
+    wav[34] = std::byte{8};
+    REQUIRE_THROWS_AS(decode_wav(wav), util::exception);
+  }
+}
+
+TEST_CASE ("WavetableLanes") {
+  const Wavetable a(saw(256));
+  std::vector<float> square(256);
+  for (std::size_t i = 0; i < square.size(); i++) square[i] = i < 128 ? 1.f : -1.f;
+  const Wavetable b(square);
+
+  SECTION ("Matches a scalar oscillator") {
+    WavetableLanes lanes;
+    const float cps = 440.f / 44100.f;
+    const float morph = 0.25f;
+    lanes.set(2, a, b, morph, cps);
+    const auto inc = static_cast<std::uint32_t>(static_cast<std::int64_t>(double(cps) * 0x1p32));
+    const auto from = a.level(Wavetable::level_for(cps));
+    const auto to = b.level(Wavetable::level_for(cps));
+    std::uint32_t phase = 0;
+    for (int i = 0; i < 4096; i++) {
+      const double x = double(phase) / 0x1p32 * Wavetable::size;
+      const auto k = static_cast<std::size_t>(x);
+      const auto frac = float(x - double(k));
+      const float va = from[k] + frac * (from[k + 1] - from[k]);
+      const float vb = to[k] + frac * (to[k + 1] - to[k]);
+      const auto res = lanes();
+      REQUIRE(res[2] == test::approx(va + morph * (vb - va)).margin(1e-4));
+      REQUIRE(res[0] == 0.f);
+      phase += inc;
+    }
+  }
+
+  SECTION ("Cleared lanes are silent") {
+    WavetableLanes lanes;
+    lanes.set(0, a, a, 0, 0.01f);
+    lanes();
+    lanes.clear(0);
+    for (int i = 0; i < 16; i++) REQUIRE(lanes()[0] == 0.f);
+  }
+}
@@ -2,7 +2,9 @@
 
 #include "lib/itc/executor.hpp"
 
+#include <memory>
 #include <thread>
+#include <vector>
 
 #include "lib/logging.hpp"
 
@@ -21,6 +23,158 @@ TEST_CASE ("QueueExecutor") {
     REQUIRE(i == 1);
   }
 
+  SECTION ("Functions are run in order, also when the ring wraps around") {
+    QueueExecutor e(4);
+    REQUIRE(e.capacity() == 4);
+    std::vector<int> order;
+    for (int round = 0; round < 5; round++) {
+      for (int i = 0; i < 3; i++) e.execute([&, i] { order.push_back(i); });
+      REQUIRE(e.has_queued());
+      e.run_queued_functions();
+      REQUIRE_FALSE(e.has_queued());
+    }
+    REQUIRE(order.size() == 15);
+    for (std::size_t i = 0; i < order.size(); i++) REQUIRE(order[i] == static_cast<int>(i % 3));
+  }
+
+  SECTION ("Large and move-only captures are destroyed exactly once") {
+    QueueExecutor e;
+    auto counter = std::make_shared<int>(0);
+    std::array<char, IExecutor::function_capacity - sizeof(std::shared_ptr<int>) - sizeof(std::unique_ptr<int>)> big = {};
+    big.back() = 42;
+    auto owned = std::make_unique<int>(1);
+    e.execute([counter, big, owned = std::move(owned)] { *counter += big.back() + *owned; });
+    REQUIRE(counter.use_count() == 2);
+    e.run_queued_functions();
+    REQUIRE(*counter == 43);
+    REQUIRE(counter.use_count() == 1);
+  }
+
+  SECTION ("try_execute fails when the queue is full, and keeps the function") {
+    QueueExecutor e(2);
+    int count = 0;
+    for (int i = 0; i < 2; i++) e.execute([&] { count++; });
+    IExecutor::Function f = [&] { count += 10; };
+    REQUIRE_FALSE(e.try_execute(f));
+    REQUIRE(f);
+    // Other priorities have their own room
+    IExecutor::Function high = [&] { count += 100; };
+    REQUIRE(e.try_execute(high, Priority::high));
+    e.run_queued_functions();
+    REQUIRE(count == 102);
+    REQUIRE(e.try_execute(f));
+    e.run_queued_functions();
+    REQUIRE(count == 112);
+    REQUIRE(e.overflows() == 0);
+  }
+
+  SECTION ("Producers on other threads can retry until there is room") {
+    QueueExecutor e(2);
+    std::atomic_int count = 0;
+    auto producer = std::thread([&] {
+      for (int i = 0; i < 100; i++) {
+        IExecutor::Function f = [&] { count++; };
+        while (!e.try_execute(f)) std::this_thread::yield();
+      }
+    });
+    while (count < 100) e.run_queued_functions();
+    producer.join();
+    REQUIRE(count == 100);
+  }
+
+  SECTION ("High priority functions run first") {
+    QueueExecutor e;
+    std::vector<int> order;
+    e.execute([&] { order.push_back(0); });
+    e.execute([&] { order.push_back(1); }, Priority::high);
+    e.execute([&] { order.push_back(2); });
+    e.execute([&] { order.push_back(3); }, Priority::high);
+    e.run_queued_functions();
+    REQUIRE(order == std::vector{1, 3, 0, 2});
+  }
+
+  SECTION ("Bounded draining stops at the function limit") {
+    QueueExecutor e;
+    int count = 0;
+    for (int i = 0; i < 10; i++) e.execute([&] { count++; });
+    REQUIRE(e.run_queued_functions(1s, 4) == 4);
+    REQUIRE(count == 4);
+    REQUIRE(e.run_queued_functions(1s, 100) == 6);
+    REQUIRE(count == 10);
+    REQUIRE(e.run_queued_functions(1s, 100) == 0);
+  }
+
+  SECTION ("Bounded draining stops when the budget is spent, but runs at least one function") {
+    QueueExecutor e;
+    int count = 0;
+    for (int i = 0; i < 10; i++) {
+      e.execute([&] {
+        count++;
+        std::this_thread::sleep_for(1ms);
+      });
+    }
+    REQUIRE(e.run_queued_functions(0ns, 100) == 1);
+    REQUIRE(e.run_queued_functions(2500us, 100) < 9);
+    REQUIRE(e.has_queued());
+  }
+
+  SECTION ("execute wakes up a blocked consumer") {
+    QueueExecutor e;
+    std::atomic_int count = 0;
+    auto consumer = std::thread([&] {
+      while (count < 100) e.run_queued_functions_blocking(10s);
+    });
+    for (int i = 0; i < 100; i++) {
+      e.execute([&] { count++; });
+      std::this_thread::sleep_for(10us);
+    }
+    consumer.join();
+    REQUIRE(count == 100);
+  }
+
+  SECTION ("Timed functions run once due, in order of time") {
+    QueueExecutor e;
+    std::vector<int> order;
+    const auto now = otto::chrono::clock::now();
+    e.execute_at(now + 20ms, [&] { order.push_back(3); });
+    e.execute_at(now + 10ms, [&] { order.push_back(1); });
+    e.execute_at(now + 10ms, [&] { order.push_back(2); });
+    REQUIRE_FALSE(e.run_queued_functions());
+    std::this_thread::sleep_until(now + 30ms);
+    REQUIRE(e.run_queued_functions());
+    REQUIRE(order == std::vector{1, 2, 3});
+  }
+
+  SECTION ("A blocking wait wakes up for the next timed function") {
+    QueueExecutor e;
+    bool ran = false;
+    const auto start = otto::chrono::clock::now();
+    e.execute_after(20ms, [&] { ran = true; });
+    e.run_queued_functions_blocking();
+    REQUIRE(ran);
+    REQUIRE(otto::chrono::clock::now() - start >= 20ms);
+  }
+
+  SECTION ("A timer added during a blocking wait shortens it") {
+    QueueExecutor e;
+    std::atomic_bool ran = false;
+    auto consumer = std::thread([&] {
+      while (!ran) e.run_queued_functions_blocking(10s);
+    });
+    std::this_thread::sleep_for(1ms);
+    const auto start = otto::chrono::clock::now();
+    e.execute_after(10ms, [&] { ran = true; });
+    consumer.join();
+    REQUIRE(otto::chrono::clock::now() - start < 5s);
+  }
+
+  SECTION ("notify before a blocking wait makes it return") {
+    QueueExecutor e;
+    e.notify();
+    e.run_queued_functions_blocking();
+    SUCCEED();
+  }
+
   SECTION ("Multithreading") {
     QueueExecutor e;
     /// The loop condition for the application
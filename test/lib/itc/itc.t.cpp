@@ -3,6 +3,7 @@
 #include "lib/itc/itc.hpp"
 
 #include <bitset>
+#include <thread>
 
 #include "stubs/state.hpp"
 
@@ -65,6 +66,38 @@ TEST_CASE ("Basic Context/Receiver/Sender linking and lifetime", "[itc]") {
     }
   }
 }
+TEST_CASE ("Context lookup", "[itc]") {
+  struct Action1 {};
+  struct Action2 {};
+
+  SECTION ("Children are created once and found by name") {
+    Context ctx;
+    Context& b = ctx["b"];
+    Context& a = ctx["a"];
+    REQUIRE(&ctx[std::string_view("b")] == &b);
+    REQUIRE(&ctx["a"] == &a);
+    REQUIRE(a.parent() == &ctx);
+    REQUIRE(ctx.children().size() == 2);
+    REQUIRE(ctx.children()[0].name == "a");
+  }
+
+  SECTION ("Providers are found through the parents") {
+    Context ctx;
+    Sender<Action1> s1{ctx};
+    Sender<Action2> s2{ctx["child"]};
+    Context& grandchild = ctx["child"]["grandchild"];
+    REQUIRE(grandchild.find_provider<action_service<Action1>>() == &s1);
+    REQUIRE(grandchild.find_provider<action_service<Action2>>() == &s2);
+    REQUIRE(ctx.find_provider<action_service<Action2>>() == nullptr);
+  }
+
+  SECTION ("A service can only have one provider per context") {
+    Context ctx;
+    Sender<Action1> s1{ctx};
+    REQUIRE_THROWS(Sender<Action1>{ctx});
+  }
+}
+
 TEST_CASE ("itc Actions", "[itc]") {
   ImmediateExecutor ex;
   StaticDomain<>::set_static_executor(ex);
@@ -94,6 +127,39 @@ TEST_CASE ("itc Actions", "[itc]") {
   }
 }
 
+TEST_CASE ("Ordinary actions do not coalesce", "[itc]") {
+  QueueExecutor ex;
+  StaticDomain<>::set_static_executor(ex);
+  std::jthread drain;
+
+  struct TestAction1 {
+    int param1 = 0;
+  };
+  Context ctx;
+  Sender<TestAction1> sender = {ctx};
+
+  struct R1 : Receiver<TestAction1>, StaticDomain<> {
+    using Receiver::Receiver;
+
+    void receive(TestAction1 action) noexcept override
+    {
+      received.push_back(action.param1);
+    }
+
+    std::vector<int> received;
+  } r1 = {ctx};
+
+  sender.send({1});
+  sender.send({2});
+  sender.send({3});
+  ex.run_queued_functions();
+  REQUIRE(r1.received == std::vector{1, 2, 3});
+
+  drain = std::jthread([&](const std::stop_token& stop) {
+    while (!stop.stop_requested()) ex.run_queued_functions_blocking(std::chrono::milliseconds(1));
+  });
+}
+
 TEST_CASE ("Context walking", "[itc]") {
   ImmediateExecutor ex;
   StaticDomain<>::set_static_executor(ex);
@@ -170,6 +236,43 @@ TEST_CASE ("Basic state passing", "[itc]") {
   }
 }
 
+TEST_CASE ("Consumers only copy the newest state", "[itc]") {
+  QueueExecutor ex;
+  StaticDomain<>::set_static_executor(ex);
+  // Receivers sync with their executor when destroyed, so it has to be run by then
+  std::jthread drain;
+  struct S {
+    int i = 0;
+  };
+  Context ctx;
+  Producer<S> p = {ctx};
+  struct C1 : Consumer<S>, StaticDomain<> {
+    using Consumer<S>::Consumer;
+
+    void on_state_change(const S& s) noexcept override
+    {
+      seen.push_back(s.i);
+    }
+
+    std::vector<int> seen;
+  } c1 = {ctx}, c2 = {ctx};
+
+  for (int i = 1; i <= 5; i++) {
+    p.state().i = i;
+    p.commit();
+  }
+  REQUIRE(c1.state().i == 0);
+  // The commits coalesce into one pending notification per consumer
+  REQUIRE(ex.run_queued_functions(std::chrono::seconds(1), 100) == 2);
+  REQUIRE(c1.seen == std::vector{5});
+  REQUIRE(c2.seen == std::vector{5});
+  REQUIRE(c2.state().i == 5);
+
+  drain = std::jthread([&](const std::stop_token& stop) {
+    while (!stop.stop_requested()) ex.run_queued_functions_blocking(std::chrono::milliseconds(1));
+  });
+}
+
 TEST_CASE ("prod/cons/chan of multiple states", "[itc]") {
   struct S1 {
     int i1 = 1;
@@ -252,6 +355,93 @@ TEST_CASE ("prod/cons/chan of multiple states", "[itc]") {
   }
 }
 
+TEST_CASE ("Transactions", "[itc]") {
+  ImmediateExecutor ex;
+  StaticDomain<>::set_static_executor(ex);
+  struct S1 {
+    int i1 = 0;
+  };
+  struct S2 {
+    int i2 = 0;
+  };
+  Context ctx;
+  Producer<S1> p1 = {ctx};
+  Producer<S2> p2 = {ctx};
+
+  struct C1 : Consumer<S1, S2>, StaticDomain<> {
+    using Consumer::Consumer;
+
+    void on_state_change(const S1& s) noexcept override
+    {
+      seen.emplace_back(s.i1, state<S2>().i2);
+    }
+
+    void on_state_change(const S2& s) noexcept override
+    {
+      seen.emplace_back(state<S1>().i1, s.i2);
+    }
+
+    std::vector<std::pair<int, int>> seen;
+  } c1 = {ctx};
+
+  SECTION ("Commits are published when the transaction ends") {
+    {
+      Transaction t;
+      p1.state().i1 = 1;
+      p1.commit();
+      p1.state().i1 = 2;
+      p1.commit();
+      REQUIRE(c1.seen.empty());
+      REQUIRE(c1.state<S1>().i1 == 0);
+    }
+    REQUIRE(c1.seen == std::vector<std::pair<int, int>>{{2, 0}});
+  }
+
+  SECTION ("Nested transactions publish with the outermost one") {
+    Transaction outer;
+    {
+      Transaction inner;
+      p1.state().i1 = 1;
+      p1.commit();
+    }
+    REQUIRE(c1.seen.empty());
+  }
+
+  SECTION ("Consumers of several states see them change together") {
+    {
+      Transaction t;
+      p1.state().i1 = 1;
+      p1.commit();
+      p2.state().i2 = 2;
+      p2.commit();
+    }
+    // Both states are updated before either hook is called
+    REQUIRE(c1.seen == std::vector<std::pair<int, int>>{{1, 2}, {1, 2}});
+  }
+
+  SECTION ("Consumers keep their previous states while a transaction publishes one of them") {
+    p1.snapshots()->begin_transaction();
+    p2.state().i2 = 2;
+    p2.commit();
+    REQUIRE(c1.seen.empty());
+    REQUIRE(c1.state<S2>().i2 == 0);
+    // The transaction notifies the consumer when it is done
+    p1.snapshots()->end_transaction();
+    p1.state().i1 = 1;
+    p1.commit();
+    REQUIRE(c1.seen == std::vector<std::pair<int, int>>{{1, 2}, {1, 2}});
+  }
+
+  SECTION ("Consumers never wait for transactions on other states") {
+    Producer<int> other = {ctx};
+    other.snapshots()->begin_transaction();
+    p1.state().i1 = 1;
+    p1.commit();
+    REQUIRE(c1.seen == std::vector<std::pair<int, int>>{{1, 0}});
+    other.snapshots()->end_transaction();
+  }
+}
+
 struct State1 {
   int i1 = 0;
   DECL_VISIT(i1);
@@ -261,6 +451,11 @@ struct State2 {
   int i2 = 0;
 };
 
+struct State3 {
+  int i3 = 0;
+  DECL_VISIT(i3);
+};
+
 TEST_CASE ("Context serialization", "[!mayfail]") {
   ImmediateExecutor ex;
   StaticDomain<>::set_static_executor(ex);
@@ -292,3 +487,106 @@ TEST_CASE ("Context serialization", "[!mayfail]") {
     REQUIRE(c1.state().i2 == 10);
   }
 }
+
+TEST_CASE ("Context binary snapshots", "[itc]") {
+  ImmediateExecutor ex;
+  StaticDomain<>::set_static_executor(ex);
+
+  SECTION ("Snapshots restore the states of the context and its children") {
+    Context ctx;
+    Producer<State1> p1{ctx};
+    Producer<State3> p3{ctx["child"]};
+    ImmCons<State1> c1{ctx};
+    ImmCons<State3> c3{ctx["child"]};
+
+    p1.state().i1 = 1;
+    p3.state().i3 = 2;
+    std::vector<std::byte> snapshot;
+    util::BinaryWriter out(snapshot);
+    util::serialize_into(out, ctx);
+
+    p1.state().i1 = 10;
+    p3.state().i3 = 20;
+    p1.commit();
+    p3.commit();
+    REQUIRE(c1.state().i1 == 10);
+
+    util::BinaryReader in(snapshot);
+    util::deserialize_from(in, ctx);
+    REQUIRE(in.remaining() == 0);
+    REQUIRE(c1.state().i1 == 1);
+    REQUIRE(c3.state().i3 == 2);
+  }
+
+  SECTION ("States that are not saved with the app are not in snapshots") {
+    // Like the states published by the audio engines
+    Context ctx;
+    Producer<State2> p2{ctx};
+    p2.state().i2 = 2;
+    std::vector<std::byte> snapshot;
+    util::BinaryWriter out(snapshot);
+    util::serialize_into(out, ctx);
+
+    p2.state().i2 = 20;
+    util::BinaryReader in(snapshot);
+    util::deserialize_from(in, ctx);
+    REQUIRE(p2.state().i2 == 20);
+    REQUIRE(p2.snapshots()->version() == 0);
+  }
+
+  SECTION ("Restoring does not touch states committed by other threads") {
+    Context ctx;
+    Producer<State1> logic{ctx};
+    Producer<State2> audio{ctx};
+    logic.state().i1 = 1;
+    std::vector<std::byte> snapshot;
+    util::BinaryWriter out(snapshot);
+    util::serialize_into(out, ctx);
+
+    std::atomic<bool> done = false;
+    std::thread audio_thread([&] {
+      while (!done) {
+        audio.state().i2++;
+        audio.commit();
+      }
+    });
+    for (int i = 0; i < 1000; i++) {
+      Transaction t;
+      util::BinaryReader in(snapshot);
+      util::deserialize_from(in, ctx);
+    }
+    done = true;
+    audio_thread.join();
+    REQUIRE(logic.state().i1 == 1);
+    REQUIRE(audio.snapshots()->version() == std::uint64_t(audio.state().i2));
+  }
+
+  SECTION ("Providers missing when reading are skipped") {
+    std::vector<std::byte> snapshot;
+    {
+      Context ctx;
+      Producer<State1> p1{ctx};
+      Producer<State3> p3{ctx};
+      p1.state().i1 = 1;
+      p3.state().i3 = 2;
+      util::BinaryWriter out(snapshot);
+      util::serialize_into(out, ctx);
+    }
+    Context ctx;
+    Producer<State3> p3{ctx};
+    util::BinaryReader in(snapshot);
+    util::deserialize_from(in, ctx);
+    REQUIRE(p3.state().i3 == 2);
+  }
+
+  SECTION ("Truncated snapshots throw") {
+    Context ctx;
+    Producer<State1> p1{ctx};
+    std::vector<std::byte> snapshot;
+    util::BinaryWriter out(snapshot);
+    util::serialize_into(out, ctx);
+    snapshot.resize(snapshot.size() - 1);
+    util::BinaryReader in(snapshot);
+    REQUIRE_THROWS_AS(util::deserialize_from(in, ctx), util::exception);
+  }
+}
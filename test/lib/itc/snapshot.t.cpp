@@ -0,0 +1,56 @@
+#include "testing.t.hpp"
+
+#include "lib/itc/snapshot.hpp"
+
+#include <thread>
+
+using namespace otto::itc;
+
+TEST_CASE ("SnapshotBuffer") {
+  SECTION ("Readers get the latest version once") {
+    SnapshotBuffer<int> buf;
+    int value = 0;
+    std::uint64_t version = 0;
+    REQUIRE_FALSE(buf.read(value, version));
+    buf.publish(1);
+    buf.publish(2);
+    REQUIRE(buf.version() == 2);
+    REQUIRE(buf.read(value, version));
+    REQUIRE(value == 2);
+    REQUIRE(version == 2);
+    REQUIRE_FALSE(buf.read(value, version));
+    buf.publish(3);
+    REQUIRE(buf.read(value, version));
+    REQUIRE(value == 3);
+  }
+
+  SECTION ("Concurrent readers never see a partially written value") {
+    struct Value {
+      std::array<int, 64> ints = {};
+    };
+    SnapshotBuffer<Value> buf;
+    std::atomic<bool> done = false;
+    std::atomic<bool> torn = false;
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 4; r++) {
+      readers.emplace_back([&] {
+        Value v;
+        std::uint64_t version = 0;
+        int last = 0;
+        while (!done) {
+          if (!buf.read(v, version)) continue;
+          if (std::ranges::any_of(v.ints, [&](int i) { return i != v.ints[0]; }) || v.ints[0] < last) torn = true;
+          last = v.ints[0];
+        }
+      });
+    }
+    Value v;
+    for (int i = 1; i <= 10000; i++) {
+      v.ints.fill(i);
+      buf.publish(v);
+    }
+    done = true;
+    for (auto& t : readers) t.join();
+    REQUIRE_FALSE(torn);
+  }
+}
@@ -0,0 +1,106 @@
+#include "testing.t.hpp"
+
+#include "lib/itc/task.hpp"
+#include "lib/util/exception.hpp"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace otto;
+using namespace otto::itc;
+using namespace std::literals;
+
+namespace {
+  Task<int> answer()
+  {
+    co_return 42;
+  }
+
+  Task<int> add_answers()
+  {
+    const int a = co_await answer();
+    const int b = co_await answer();
+    co_return a + b;
+  }
+
+  Task<> fail()
+  {
+    throw util::exception("Task failed");
+    co_return;
+  }
+} // namespace
+
+TEST_CASE ("Task") {
+  SECTION ("Tasks are lazy, and can await each other") {
+    bool started = false;
+    // Coroutine lambdas take their state as parameters, since the lambda object is gone when they run
+    auto task = [](bool& started) -> Task<int> {
+      started = true;
+      co_return co_await add_answers();
+    }(started);
+    REQUIRE_FALSE(started);
+    REQUIRE(std::move(task).sync_wait() == 84);
+    REQUIRE(started);
+  }
+
+  SECTION ("Exceptions are rethrown to the awaiter") {
+    REQUIRE_THROWS_AS(fail().sync_wait(), util::exception);
+  }
+
+  SECTION ("Awaiting an executor continues on its thread") {
+    QueueExecutor a;
+    QueueExecutor b;
+    std::vector<std::thread::id> threads;
+    auto run = [](QueueExecutor& e, const std::stop_token& st) {
+      std::stop_callback wake(st, [&] { e.notify(); });
+      while (!st.stop_requested()) e.run_queued_functions_blocking();
+    };
+    std::jthread thread_a([&](const std::stop_token& st) { run(a, st); });
+    std::jthread thread_b([&](const std::stop_token& st) { run(b, st); });
+    auto task = [](QueueExecutor& a, QueueExecutor& b, std::vector<std::thread::id>& threads) -> Task<> {
+      for (int i = 0; i < 3; i++) {
+        co_await a;
+        threads.push_back(std::this_thread::get_id());
+        co_await b;
+        threads.push_back(std::this_thread::get_id());
+      }
+    }(a, b, threads);
+    std::move(task).sync_wait();
+    REQUIRE(threads.size() == 6);
+    for (std::size_t i = 0; i < threads.size(); i++) {
+      REQUIRE(threads[i] == (i % 2 == 0 ? thread_a : thread_b).get_id());
+    }
+  }
+
+  SECTION ("Detached tasks run to completion and clean up") {
+    QueueExecutor e;
+    auto counter = std::make_shared<int>(0);
+    auto task = [](QueueExecutor& e, std::shared_ptr<int> counter) -> Task<> {
+      (*counter)++;
+      co_await e;
+      (*counter)++;
+    }(e, counter);
+    REQUIRE(*counter == 0);
+    std::move(task).detach();
+    REQUIRE(*counter == 1);
+    REQUIRE(counter.use_count() == 2);
+    e.run_queued_functions();
+    REQUIRE(*counter == 2);
+    REQUIRE(counter.use_count() == 1);
+  }
+
+  SECTION ("resume_after continues once the delay has passed") {
+    QueueExecutor e;
+    bool done = false;
+    const auto start = chrono::clock::now();
+    auto task = [](QueueExecutor& e, bool& done) -> Task<> {
+      co_await resume_after(e, 10ms);
+      done = true;
+    }(e, done);
+    std::move(task).detach();
+    REQUIRE_FALSE(done);
+    while (!done) e.run_queued_functions_blocking();
+    REQUIRE(chrono::clock::now() - start >= 10ms);
+  }
+}
@@ -0,0 +1,55 @@
+#include "testing.t.hpp"
+
+#include "lib/json.hpp"
+
+using namespace otto;
+
+TEST_CASE ("json files") {
+  const json::value v = {{"name", "otto"}, {"values", {1, 2.5, true, nullptr}}, {"nested", {{"key", "value"}}}};
+
+  SECTION ("The format is chosen by extension") {
+    REQUIRE(json::format_of("state.cbor") == json::Format::cbor);
+    REQUIRE(json::format_of("state.msgpack") == json::Format::msgpack);
+    REQUIRE(json::format_of("state.json") == json::Format::json);
+    REQUIRE(json::format_of("state") == json::Format::json);
+  }
+
+  SECTION ("Round trip") {
+    for (const auto* name : {"round_trip.json", "round_trip.cbor", "round_trip.msgpack"}) {
+      auto path = test::temp_file(name);
+      json::write_to_file(v, path);
+      REQUIRE(json::parse_file(path) == v);
+    }
+  }
+
+  SECTION ("Binary files are smaller") {
+    REQUIRE(json::dump(v, json::Format::cbor).size() < json::dump(v, json::Format::json).size());
+    REQUIRE(json::dump(v, json::Format::msgpack).size() < json::dump(v, json::Format::json).size());
+  }
+
+  SECTION ("Json text is read from a binary file name") {
+    auto path = test::temp_file("text.cbor");
+    {
+      std::ofstream f(path);
+      f << "// comment\n" << v;
+    }
+    REQUIRE(json::parse_file(path) == v);
+  }
+
+  SECTION ("The json file is read if the binary file does not exist yet") {
+    auto path = test::temp_file("migrated.cbor");
+    auto json_path = test::temp_file("migrated.json");
+    json::write_to_file(v, json_path);
+    REQUIRE(json::find_file(path) == json_path);
+    REQUIRE(json::parse_file(path) == v);
+    json::write_to_file(v, path);
+    REQUIRE(json::find_file(path) == path);
+  }
+
+  SECTION ("Errors") {
+    REQUIRE_THROWS_AS(json::parse_file(test::temp_file("does_not_exist.cbor")), std::system_error);
+    auto data = json::dump(v, json::Format::cbor);
+    data.resize(data.size() / 2);
+    REQUIRE_THROWS_AS(json::parse(data, json::Format::cbor), json::value::parse_error);
+  }
+}
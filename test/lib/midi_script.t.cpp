@@ -0,0 +1,51 @@
+#include "testing.t.hpp"
+
+#include <sstream>
+
+#include "lib/midi_script.hpp"
+
+using namespace otto;
+using namespace otto::midi;
+
+TEST_CASE ("MidiScript") {
+  const auto parse = [](std::string text) {
+    std::istringstream input(std::move(text));
+    return MidiScript::parse(input);
+  };
+
+  SECTION ("Parses events, comments and the end time") {
+    auto script = parse(R"(
+      # A comment
+      0.5  note_off 60
+      0.0  note_on  60 90  # inline comment
+      0.0  note_on  64
+      0.25 pitch_bend 8192 ch=2
+      0.25 poly_aftertouch 60 10
+      3    end
+    )");
+    REQUIRE(script.events.size() == 5);
+    REQUIRE(script.end_time == 3);
+    // Sorted by time, stable within the same time
+    REQUIRE(script.events[0].time == 0);
+    REQUIRE(std::get<NoteOn>(script.events[0].event) == NoteOn{.note = 60, .velocity = 90});
+    REQUIRE(std::get<NoteOn>(script.events[1].event) == NoteOn{.note = 64, .velocity = 100});
+    REQUIRE(std::get<PitchBend>(script.events[2].event) == PitchBend{.pitch_bend = 8192, .channel = 2});
+    REQUIRE(std::get<PolyAftertouch>(script.events[3].event) == PolyAftertouch{.note = 60, .aftertouch = 10});
+    REQUIRE(script.events[4].time == 0.5);
+    REQUIRE(std::holds_alternative<NoteOff>(script.events[4].event));
+  }
+
+  SECTION ("The end time defaults to the last event") {
+    REQUIRE(parse("1 note_on 60\n2 note_off 60\n").end_time == 2);
+    REQUIRE(parse("").end_time == 0);
+  }
+
+  SECTION ("Invalid lines throw") {
+    REQUIRE_THROWS(parse("note_on 60"));
+    REQUIRE_THROWS(parse("0 note_on"));
+    REQUIRE_THROWS(parse("0 note_on 128"));
+    REQUIRE_THROWS(parse("0 note_on 60 100 20"));
+    REQUIRE_THROWS(parse("0 foo 60"));
+    REQUIRE_THROWS(parse("-1 note_on 60"));
+  }
+}
@@ -2,6 +2,8 @@
 
 #include "lib/util/audio_buffer.hpp"
 
+#include <thread>
+
 #include <tl/optional.hpp>
 
 using namespace otto;
@@ -77,4 +79,67 @@ TEST_CASE ("AudioBufferPool") {
     REQUIRE(idx(*b3) == 3);
     REQUIRE(idx(*b4) == 4);
   };
+
+  SECTION ("in_use, high_water_mark and outstanding") {
+    tl::optional b0 = abp.allocate();
+    tl::optional b1 = abp.allocate(3);
+    REQUIRE(abp.in_use() == 4);
+    REQUIRE(abp.outstanding() == std::vector<std::size_t>{0, 1, 2, 3});
+    b1 = tl::nullopt;
+    REQUIRE(abp.in_use() == 1);
+    REQUIRE(abp.high_water_mark() == 4);
+    abp.reset_high_water_mark();
+    REQUIRE(abp.high_water_mark() == 1);
+  }
+
+  SECTION ("Moving a buffer into another releases the old one") {
+    auto b0 = abp.allocate();
+    auto b1 = abp.allocate();
+    b0 = std::move(b1);
+    REQUIRE(abp.in_use() == 1);
+    REQUIRE(idx(b0) == 1);
+  }
+
+  SECTION ("try_allocate fails when the pool is full") {
+    auto b0 = abp.allocate(4);
+    auto b1 = abp.allocate(3);
+    REQUIRE_FALSE(abp.try_allocate(2).has_value());
+    REQUIRE(abp.failed_allocations() == 1);
+    auto b2 = abp.try_allocate(1);
+    REQUIRE(b2.has_value());
+    REQUIRE(idx(*b2) == 7);
+  }
+
+  SECTION ("Pools larger than 64 buffers") {
+    auto big = util::AudioBufferPool(100, 4);
+    std::vector<util::audio_buffer> bufs;
+    for (int i = 0; i < 100; i++) bufs.push_back(big.allocate());
+    REQUIRE_FALSE(big.try_allocate().has_value());
+    bufs.clear();
+    // Runs do not cross a 64 buffer boundary
+    auto b0 = big.allocate(60);
+    auto b1 = big.allocate(8);
+    REQUIRE((b1.data() - big.data().data()) / 4 == 64);
+  }
+
+  SECTION ("Allocation from multiple threads") {
+    auto pool = util::AudioBufferPool(32, 16);
+    std::atomic<bool> shared = false;
+    std::vector<std::jthread> threads;
+    for (int t = 0; t < 4; t++) {
+      threads.emplace_back([&pool, &shared, t] {
+        for (int i = 0; i < 10000; i++) {
+          auto a = pool.allocate(1 + i % 3);
+          auto b = pool.allocate();
+          std::ranges::fill(a, float(t));
+          std::ranges::fill(b, float(t));
+          if (!std::ranges::all_of(a, [t](float f) { return f == float(t); })) shared = true;
+        }
+      });
+    }
+    threads.clear();
+    REQUIRE_FALSE(shared);
+    REQUIRE(pool.in_use() == 0);
+    REQUIRE(pool.failed_allocations() == 0);
+  }
 }
@@ -0,0 +1,81 @@
+#include "testing.t.hpp"
+
+#include "lib/util/binary_serialization.hpp"
+#include "lib/util/with_limits.hpp"
+
+using namespace otto;
+
+namespace {
+  struct Inner {
+    util::StaticallyBounded<int, 0, 10> bounded = 5;
+    float f = 0;
+    DECL_VISIT(bounded, f);
+    bool operator==(const Inner&) const = default;
+  };
+
+  struct Outer {
+    std::string name = "default";
+    std::vector<int> values;
+    std::array<Inner, 2> inners;
+    json::value extra;
+    int not_visited = 0;
+    DECL_VISIT(name, values, inners, extra);
+  };
+
+  template<typename T>
+  T round_trip(const T& value)
+  {
+    std::vector<std::byte> data;
+    util::BinaryWriter out(data);
+    util::serialize_into(out, value);
+    T res = {};
+    util::BinaryReader in(data);
+    util::deserialize_from(in, res);
+    REQUIRE(in.remaining() == 0);
+    return res;
+  }
+} // namespace
+
+TEST_CASE ("binary serialization") {
+  static_assert(util::ABinarySerializable<Outer>);
+  static_assert(util::ABinarySerializable<Inner>);
+
+  SECTION ("Trivially copyable types are copied") {
+    REQUIRE(round_trip(42) == 42);
+    REQUIRE(round_trip(Inner{.bounded = 3, .f = 1.5f}) == Inner{.bounded = 3, .f = 1.5f});
+  }
+
+  SECTION ("Visitable types are written member by member") {
+    Outer o;
+    o.name = "slot";
+    o.values = {1, 2, 3};
+    o.inners[1].f = 2.f;
+    o.extra = {{"key", "value"}};
+    o.not_visited = 7;
+    const auto res = round_trip(o);
+    REQUIRE(res.name == "slot");
+    REQUIRE(res.values == std::vector{1, 2, 3});
+    REQUIRE(res.inners == o.inners);
+    REQUIRE(res.extra == o.extra);
+    REQUIRE(res.not_visited == 0);
+  }
+
+  SECTION ("Writing into a cleared buffer reuses its capacity") {
+    Outer o;
+    o.values.resize(100);
+    std::vector<std::byte> data;
+    util::BinaryWriter out(data);
+    util::serialize_into(out, o);
+    const auto* ptr = data.data();
+    data.clear();
+    util::serialize_into(out, o);
+    REQUIRE(data.data() == ptr);
+  }
+
+  SECTION ("Reading past the end throws") {
+    std::vector<std::byte> data(2);
+    util::BinaryReader in(data);
+    int i = 0;
+    REQUIRE_THROWS_AS(util::deserialize_from(in, i), util::exception);
+  }
+}
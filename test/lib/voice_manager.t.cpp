@@ -368,7 +368,8 @@ TEST_CASE ("VoiceManager", "[!mayfail]") {
       v.calc_next();
       REQUIRE(v.frequency() == test::approx(midi::note_freq(50)).margin(0.01));
       voices.handle(midi::NoteOn{62});
-      v.calc_next();
+      // The glide is stepped at control rate, and interpolated over one control period
+      for (std::size_t i = 0; i < dsp::ControlDomain::master().decimation(); i++) v.calc_next();
       REQUIRE(v.frequency() == test::approx(target_freq).margin(0.01));
     }
 
@@ -383,9 +384,11 @@ TEST_CASE ("VoiceManager", "[!mayfail]") {
 
       auto& v = triggered_voices().front();
       float f = midi::note_freq(50);
-      // Skip first frame, which should be the start frequency
-      v.calc_next();
-      REQUIRE(v.frequency() == f);
+      // Skip first control period, which should be the start frequency
+      for (std::size_t i = 0; i < dsp::ControlDomain::master().decimation(); i++) {
+        v.calc_next();
+        REQUIRE(v.frequency() == f);
+      }
       for (int i = 0; i < expected_n; i++) {
         v.calc_next();
         INFO("i = " << i);
@@ -437,5 +440,85 @@ TEST_CASE ("VoiceManager", "[!mayfail]") {
     }
 
     SECTION ("Voice::calc_next is called before each Voice::operator()") {}
+
+    SECTION ("VoiceManager::process matches the per-sample VoiceManager::operator()") {
+      struct SVoice : voices::VoiceBase<SVoice> {
+        float operator()() noexcept
+        {
+          return frequency() * float(++n);
+        }
+        int n = 0;
+      };
+
+      itc::Channel chan;
+      itc::Producer<VoicesState> prod = chan;
+      prod.state().portamento = 0.5f;
+      prod.commit();
+      VoiceManager<SVoice, 4> block_vmgr(chan);
+      VoiceManager<SVoice, 4> sample_vmgr(chan);
+      for (auto* vm : {&block_vmgr, &sample_vmgr}) {
+        vm->handle(midi::NoteOn{50});
+        vm->handle(midi::NoteOn{62});
+      }
+
+      std::array<float, 64> block;
+      std::array<float, 64> samples;
+      block_vmgr.process(block);
+      stdr::generate(samples, std::ref(sample_vmgr));
+      for (auto&& [b, s] : util::zip(block, samples)) {
+        REQUIRE(b == test::approx(s));
+      }
+    }
+
+    SECTION ("Idle voices are skipped") {
+      struct IVoice : voices::VoiceBase<IVoice> {
+        [[nodiscard]] bool is_idle() const noexcept
+        {
+          return !is_triggered();
+        }
+        float operator()() noexcept
+        {
+          calls++;
+          return 1.f;
+        }
+        int calls = 0;
+      };
+
+      itc::Channel chan;
+      VoiceManager<IVoice, 4> vmgr(chan);
+      REQUIRE(vmgr.idle_count() == 4);
+      vmgr.handle(midi::NoteOn{50});
+      REQUIRE(vmgr.idle_count() == 3);
+
+      std::array<float, 16> block;
+      vmgr.process(block);
+      for (float f : block) REQUIRE(f == test::approx(vmgr.normal_volume));
+      REQUIRE(vmgr() == test::approx(vmgr.normal_volume));
+      REQUIRE(std::ranges::count_if(vmgr, [](IVoice& v) { return v.calls > 0; }) == 1);
+
+      vmgr.handle(midi::NoteOff{50});
+      REQUIRE(vmgr.idle_count() == 4);
+      vmgr.process(block);
+      for (float f : block) REQUIRE(f == 0.f);
+    }
+
+    SECTION ("Voice::process can replace the per-sample adapter") {
+      struct BVoice : voices::VoiceBase<BVoice> {
+        void process(std::span<float> output) noexcept
+        {
+          calls++;
+          for (float& f : output) f += volume();
+        }
+        int calls = 0;
+      };
+
+      itc::Channel chan;
+      VoiceManager<BVoice, 4> vmgr(chan);
+      std::array<float, 16> block;
+      block.fill(10.f);
+      vmgr.process(block);
+      for (float f : block) REQUIRE(f == test::approx(4 * vmgr.normal_volume));
+      for (auto& v : vmgr) REQUIRE(v.calls == 1);
+    }
   }
 } // namespace otto::core::voices
@@ -46,11 +46,9 @@ namespace otto::engines {
       {
         osc.freq(state().freq);
       }
-      [[nodiscard]] util::audio_buffer process() const noexcept
+      void process(util::audio_buffer& output) noexcept
       {
-        auto buf = buffer_pool().allocate();
-        std::ranges::generate(buf, osc);
-        return buf;
+        std::ranges::generate(output, osc);
       }
       gam::Sine<> osc;
     };
@@ -95,8 +93,20 @@ TEST_CASE ("simple_engine", "[.interactive]") {
   engines::Simple::Handler h;
   itc::set_producer(h, l);
 
+  AudioGraph graph;
+  AudioGraph::NodeId node = 0;
+  node = graph.add_node(
+    "simple",
+    [&](std::size_t) noexcept {
+      auto output = graph.output(node, 0);
+      a.process(output);
+    },
+    1);
+  audio.compile_graph(graph);
+
   auto stop_audio = audio.set_process_callback([&](Audio::CallbackData data) {
-    const auto res = a.process();
+    graph.process(data.output.size());
+    const auto res = graph.output(node, 0);
     std::ranges::copy(util::zip(res, res), data.output.begin());
   });
   auto stop_graphics = graphics.show([&](SkCanvas& ctx) { s.draw(ctx); });
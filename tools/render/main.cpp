@@ -0,0 +1,6 @@
+#include "app/offline_render.hpp"
+
+int main(int argc, char* argv[])
+{
+  return otto::offline_render_main(argc, argv);
+}